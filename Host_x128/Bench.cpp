@@ -0,0 +1,472 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Bench.cpp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "MacroDefinition.h"
+#include "FluidSimProc.h"
+#include "StopWatch.h"
+#include "Trace.h"
+#include "Histogram.h"
+
+using namespace sge;
+
+#define STAGE_SOURCE    0
+#define STAGE_VELOCITY  1
+#define STAGE_DENSITY   2
+#define STAGE_NODES     3
+#define STAGE_VOLUME    4
+#define STAGES          5
+
+static const char *t_stagename[STAGES] = { "source", "velocity", "density", "nodes", "volume" };
+
+static void Usage( const char *app )
+{
+	printf( "usage: %s [-n steps] [-g nx[,ny,nz]] [-s double|float] [-t threads] [-r gs|rb|jacobi]\n"
+		"       [-i scalar|avx2|avx512] [-p jacobi|vcycle|fmg] [-e tolerance] [-c cycles]\n"
+		"       [-b depth] [-l rows|bricks|sparse] [-m single|twolevel] [-a gate]\n"
+		"       [-x interpolate|exchange] [-f on|off] [-o snapshot] [-w snapshot] [-k steps]\n"
+		"       [-d sync|fork] [-v frames] [-u on|off] [-q depth] [-z block|drop] [-j trace]\n"
+		"       [-h on|off] [-y counters] [-R on|off]\n"
+		"  -n  number of simulation steps, default %d\n"
+		"  -g  grid extent, a single value gives a cubic grid, default %dx%dx%d\n"
+		"  -s  storage precision of the fields, default double\n"
+		"  -t  worker threads, 0 for one per core, default 0\n"
+		"  -r  relaxation ordering of Jacobi, default rb\n"
+		"  -i  instruction set of the stencils, default the widest the CPU supports\n"
+		"  -p  pressure solver of the projection, default jacobi\n"
+		"  -e  relative residual the multigrid solvers stop at, default 1e-4\n"
+		"  -c  most V-cycles per projection, default 20\n"
+		"  -b  Jacobi sweeps per pass over the grid, 0 for one, default %d; a depth\n"
+		"      keeps no more than that many threads busy\n"
+		"  -l  storage order of the fields, bricks run the scalar stencils, sparse the\n"
+		"      active bricks only with the Jacobi pressure solve, default rows\n"
+		"  -m  single solves the grid alone, twolevel takes it as the global grid of\n"
+		"      %dx%dx%d subnodes at twice its resolution, default single\n"
+		"  -a  density a subnode must hold to be solved, negative for all, default %g\n"
+		"  -x  how the subnodes get their state, upsampled from the global grid every\n"
+		"      step, or kept and passed between neighbours, default interpolate\n"
+		"  -f  average the solved subnodes back into the global grid, default off\n"
+		"  -o  resume from a snapshot of the same grid, storage and precision, with the\n"
+		"      solver settings it was saved with, and run -n steps more\n"
+		"  -w  save a snapshot after the last step\n"
+		"  -k  save it every that many steps as well, default 0, at the end only\n"
+		"  -d  how -k saves, sync stops the solver until written, fork only while a\n"
+		"      child process is forked to write it, Linux only, default sync\n"
+		"  -v  write the density of every step to a raw file, with an index next to it\n"
+		"  -u  write the velocity along with it, default off\n"
+		"  -q  frame buffers between the solver and the writer, default %d\n"
+		"  -z  when the writer falls behind, the solver waits, or the frame is dropped,\n"
+		"      default block\n"
+		"  -j  write a timeline of the stages of every thread, for chrome://tracing,\n"
+		"      of the last %d events of each\n"
+		"  -h  count cycles, instructions, LLC and dTLB misses of the stages of the\n"
+		"      grid, Linux only, default off\n"
+		"  -y  write those counts of every step to a CSV file, implies -h on\n"
+		"  -R  measure the residual of the Jacobi pressure solve as well, a pass over\n"
+		"      the grid in each projection, default off\n",
+		app, TIMES, GRIDS_X, GRIDS_Y, GRIDS_Z, TEMPORAL_DEPTH, NODES_X, NODES_Y, NODES_Z, NODES_GATE,
+		EXPORT_DEPTH, TRACE_EVENTS );
+};
+
+
+/* run the solver for a fixed number of steps without any window and report *
+ * the wall time of every stage                                             */
+int main( int argc, char **argv )
+{
+	int steps = TIMES, threads = 0;
+	int nx = GRIDS_X, ny = GRIDS_Y, nz = GRIDS_Z;
+	SCALAR scalar = SCALAR_DOUBLE;
+	RELAXATION relax = RELAX_RED_BLACK;
+	SIMD simd = DetectSimd();
+	PRESSURESOLVER pressure = PRESSURE_JACOBI;
+	double tolerance = 1e-4;
+	int cycles = 20;
+	int depth = TEMPORAL_DEPTH;
+	STORAGE storage = STORAGE_ROWS;
+	bool twolevel = false;
+	double gate = NODES_GATE;
+	NODESYNC sync = NODES_INTERPOLATE;
+	bool restrict = false;
+	const char *load = NULL, *save = NULL;
+	int every = 0;
+	bool forked = false;
+	const char *frames = NULL;
+	bool velocity = false;
+	int queue = EXPORT_DEPTH;
+	EXPORTPOLICY policy = EXPORT_BLOCK;
+	const char *trace = NULL;
+	bool counters = false;
+	const char *countfile = NULL;
+	bool residual = false;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		string opt = argv[i];
+		const char *val = ( i + 1 < argc ) ? argv[i + 1] : NULL;
+
+		if ( val eqt NULL ) { Usage( argv[0] ); return 1; }
+
+		if ( opt eqt "-n" ) steps = atoi( val );
+		elif ( opt eqt "-t" ) threads = atoi( val );
+		elif ( opt eqt "-e" ) tolerance = atof( val );
+		elif ( opt eqt "-c" ) cycles = atoi( val );
+		elif ( opt eqt "-b" ) depth = atoi( val );
+		elif ( opt eqt "-a" ) gate = atof( val );
+		elif ( opt eqt "-o" ) load = val;
+		elif ( opt eqt "-w" ) save = val;
+		elif ( opt eqt "-k" ) every = atoi( val );
+		elif ( opt eqt "-v" ) frames = val;
+		elif ( opt eqt "-q" ) queue = atoi( val );
+		elif ( opt eqt "-j" ) trace = val;
+		elif ( opt eqt "-y" ) { countfile = val; counters = true; }
+		elif ( opt eqt "-g" )
+		{
+			int n = sscanf( val, "%d,%d,%d", &nx, &ny, &nz );
+			if ( n eqt 1 ) ny = nz = nx;
+			elif ( n not_eq 3 ) { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-s" )
+		{
+			string mode = val;
+			if ( mode eqt "double" ) scalar = SCALAR_DOUBLE;
+			elif ( mode eqt "float" ) scalar = SCALAR_FLOAT;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-r" )
+		{
+			string mode = val;
+			if ( mode eqt "gs" ) relax = RELAX_GAUSS_SEIDEL;
+			elif ( mode eqt "rb" ) relax = RELAX_RED_BLACK;
+			elif ( mode eqt "jacobi" ) relax = RELAX_JACOBI;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-i" )
+		{
+			string mode = val;
+			if ( mode eqt "scalar" ) simd = SIMD_SCALAR;
+			elif ( mode eqt "avx2" ) simd = SIMD_AVX2;
+			elif ( mode eqt "avx512" ) simd = SIMD_AVX512;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-l" )
+		{
+			string mode = val;
+			if ( mode eqt "rows" ) storage = STORAGE_ROWS;
+			elif ( mode eqt "bricks" ) storage = STORAGE_BRICKS;
+			elif ( mode eqt "sparse" ) storage = STORAGE_SPARSE;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-m" )
+		{
+			string mode = val;
+			if ( mode eqt "single" ) twolevel = false;
+			elif ( mode eqt "twolevel" ) twolevel = true;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-x" )
+		{
+			string mode = val;
+			if ( mode eqt "interpolate" ) sync = NODES_INTERPOLATE;
+			elif ( mode eqt "exchange" ) sync = NODES_EXCHANGE;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-f" )
+		{
+			string mode = val;
+			if ( mode eqt "on" ) restrict = true;
+			elif ( mode eqt "off" ) restrict = false;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-d" )
+		{
+			string mode = val;
+			if ( mode eqt "sync" ) forked = false;
+			elif ( mode eqt "fork" ) forked = true;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-u" )
+		{
+			string mode = val;
+			if ( mode eqt "on" ) velocity = true;
+			elif ( mode eqt "off" ) velocity = false;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-z" )
+		{
+			string mode = val;
+			if ( mode eqt "block" ) policy = EXPORT_BLOCK;
+			elif ( mode eqt "drop" ) policy = EXPORT_DROP;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-h" )
+		{
+			string mode = val;
+			if ( mode eqt "on" ) counters = true;
+			elif ( mode eqt "off" ) counters = false;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-R" )
+		{
+			string mode = val;
+			if ( mode eqt "on" ) residual = true;
+			elif ( mode eqt "off" ) residual = false;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-p" )
+		{
+			string mode = val;
+			if ( mode eqt "jacobi" ) pressure = PRESSURE_JACOBI;
+			elif ( mode eqt "vcycle" ) pressure = PRESSURE_VCYCLE;
+			elif ( mode eqt "fmg" ) pressure = PRESSURE_FMG;
+			else { Usage( argv[0] ); return 1; }
+		}
+		else { Usage( argv[0] ); return 1; }
+
+		i++;
+	}
+
+	if ( steps <= 0 or nx < 3 or ny < 3 or nz < 3 )
+	{
+		Usage( argv[0] );
+		return 1;
+	}
+
+	if ( trace not_eq NULL )
+	{
+		Tracer::Enable( true );
+		Tracer::NameThread( "solver" );
+	}
+
+	FLUIDSPARAM fluid;
+	fluid.run = true;
+	fluid.volume.ptrData = NULL;
+
+	FluidSimProc *simproc = new FluidSimProc( &fluid, nx, ny, nz, scalar, storage );
+	simproc->SetThreads( threads );
+	simproc->SetRelaxation( relax );
+	simproc->SetSimd( simd );
+	simproc->SetTemporalBlocking( depth );
+	simproc->SetPressureSolver( pressure, tolerance, cycles );
+	simproc->SetJacobiResidual( residual );
+	if ( twolevel )
+	{
+		simproc->EnableSubnodes( &fluid, gate, sync );
+		simproc->SetNodeRestriction( restrict );
+	}
+
+	/* the settings of the snapshot win over the ones above */
+	if ( ( load not_eq NULL and not simproc->LoadPreStage( load ) ) or
+		( frames not_eq NULL and not simproc->StartExport( frames, velocity, queue, policy ) ) )
+	{
+		simproc->FreeResource();
+		delete simproc;
+		return 1;
+	}
+
+	/* after the snapshot is loaded, the counters would take in its reading too; *
+	 * every thread of the process is counted, the pool's and the exporter's     */
+	FILE *countcsv = NULL;
+	if ( counters and simproc->EnableCounters( true ) and countfile not_eq NULL )
+	{
+		countcsv = fopen( countfile, "w" );
+		if ( countcsv eqt NULL ) printf( "open %s failed\n", countfile );
+		else fprintf( countcsv, "step,stage,calls,cycles,instructions,llc_misses,dtlb_misses\n" );
+	}
+
+	PERFSAMPLE counts[PERF_STAGES];
+
+	double total[STAGES] = { 0.f };
+	double step[STAGES];
+
+	/* every step of the run, for the tail of each stage; the solver keeps only *
+	 * the last LATENCY_WINDOW seconds                                          */
+	LatencyHistogram latency[STAGES], steplatency;
+	StopWatch watch;
+
+	printf( "step    source(ms)  velocity(ms)  density(ms)    nodes(ms)  volume(ms)  V-cycles  residual\n" );
+
+	int spent = simproc->GetPressureCycles(), vcycles = 0;
+	double solved = 0.f, nodetime = 0.f;
+	int checkpoints = 0;
+	double stall = 0.f, maxstall = 0.f;
+
+	for ( int n = 0; n < steps; n++ )
+	{
+		simproc->ResetCounters();
+
+		watch.Start();
+		simproc->SourceSolver( DELTATIME );
+		step[STAGE_SOURCE] = watch.Lap();
+
+		simproc->VelocitySolver( DELTATIME );
+		step[STAGE_VELOCITY] = watch.Lap();
+
+		simproc->DensitySolver( DELTATIME );
+		step[STAGE_DENSITY] = watch.Lap();
+
+		/* the three stages above are SolveGlobalFlux of the two-level scheme */
+		if ( twolevel )
+		{
+			simproc->SolveNodeFlux();
+			solved   += simproc->GetSolvedNodes();
+			nodetime += simproc->GetNodeSolveTime();
+		}
+		step[STAGE_NODES] = watch.Lap();
+
+		simproc->GenerVolumeImg();
+		simproc->ExportFrame();
+		bool refreshed = simproc->RefreshStatus( &fluid );
+		step[STAGE_VOLUME] = watch.Lap();
+
+		printf( "%-6d", simproc->GetSteps() - 1 );
+		for ( int i = 0; i < STAGES; i++ )
+		{
+			printf( "  %10.3f", step[i] * 1000.0 );
+			total[i] += step[i];
+			latency[i].Record( step[i] );
+		}
+		steplatency.Record( step[STAGE_SOURCE] + step[STAGE_VELOCITY] + step[STAGE_DENSITY] + step[STAGE_NODES] +
+			step[STAGE_VOLUME] );
+
+		/* V-cycles of both projections of this step, residual of the last */
+		vcycles = simproc->GetPressureCycles() - spent;
+		spent   = simproc->GetPressureCycles();
+		if ( simproc->GetPressureResidual() >= 0.f )
+			printf( "  %8d  %8.2e\n", vcycles, simproc->GetPressureResidual() );
+		else
+			printf( "  %8d  %8s\n", vcycles, "-" );
+
+		/* once a second, the tail of the last seconds, as the window shows it */
+		if ( refreshed ) simproc->PrintLatency();
+
+		/* the counts of the frame, summed over the calls of each stage */
+		for ( int i = 0; i < PERF_STAGES; i++ )
+		{
+			const PERFSAMPLE &sample = simproc->GetStageCounters( (PERFSTAGE)i );
+
+			for ( int c = 0; c < PERF_COUNTERS; c++ ) counts[i].counts[c] += sample.counts[c];
+			counts[i].calls += sample.calls;
+
+			if ( countcsv not_eq NULL )
+				fprintf( countcsv, "%d,%s,%d,%llu,%llu,%llu,%llu\n", simproc->GetSteps() - 1, PerfCounters::StageName( i ),
+					sample.calls, sample.counts[PERF_CYCLES], sample.counts[PERF_INSTRUCTIONS],
+					sample.counts[PERF_LLC_MISSES], sample.counts[PERF_DTLB_MISSES] );
+		}
+
+		/* outside the timed stages, though a fork leaves the pages of the next steps *
+		 * to be copied on write, which shows in their times                          */
+		if ( save not_eq NULL and every > 0 and ( n + 1 ) % every eqt 0 and n + 1 < steps )
+		{
+			watch.Start();
+			if ( forked ) simproc->ForkCurStage( save ); else simproc->SaveCurStage( save );
+			double lap = watch.Elapsed();
+
+			checkpoints++;
+			stall += lap;
+			if ( lap > maxstall ) maxstall = lap;
+		}
+	}
+
+	/* the last snapshot is the one to keep */
+	simproc->WaitCheckpoint( true );
+	if ( save not_eq NULL ) simproc->SaveCurStage( save );
+
+	/* throughput in million interior cells per second */
+	double cells = (double)( nx - 2 ) * ( ny - 2 ) * ( nz - 2 ) * steps / 1e6;
+
+	/* the tail along with the mean, a slow step now and then hides in the mean */
+	double sum = 0.f;
+	printf( "\n%-10s %12s %12s %12s %10s %10s %10s %10s\n", "stage", "total(s)", "mean(ms)", "Mcells/s",
+		"p50(ms)", "p95(ms)", "p99(ms)", "max(ms)" );
+	for ( int i = 0; i < STAGES; i++ )
+	{
+		if ( i eqt STAGE_NODES and not twolevel ) continue;
+
+		printf( "%-10s %12.4f %12.3f %12.1f %10.3f %10.3f %10.3f %10.3f\n", t_stagename[i], total[i],
+			total[i] * 1000.0 / steps, cells / total[i], latency[i].Percentile( 50 ) * 1000.0,
+			latency[i].Percentile( 95 ) * 1000.0, latency[i].Percentile( 99 ) * 1000.0, latency[i].Max() * 1000.0 );
+		sum += total[i];
+	}
+	printf( "%-10s %12.4f %12.3f %12.1f %10.3f %10.3f %10.3f %10.3f\n", "step", sum, sum * 1000.0 / steps, cells / sum,
+		steplatency.Percentile( 50 ) * 1000.0, steplatency.Percentile( 95 ) * 1000.0,
+		steplatency.Percentile( 99 ) * 1000.0, steplatency.Max() * 1000.0 );
+
+	/* the same numbers whatever the threads, runs that differ here did different work */
+	printf( "\ndensity sum %.17g, max %.17g, %.0f cells not zero\n", simproc->ReduceDensity( REDUCE_SUM ),
+		simproc->ReduceDensity( REDUCE_MAX ), simproc->ReduceDensity( REDUCE_NONZERO ) );
+
+	/* how much of the grid a sparse run ended up holding */
+	const GridLayout &grid = simproc->GetGrid();
+	if ( grid.storage eqt STORAGE_SPARSE )
+		printf( "\nactive bricks %d of %d, %d slots, %.1f MB a field\n", (int)grid.map->Active().size(),
+			grid.map->Size(), grid.map->Slots(), grid.Elements() * ( scalar eqt SCALAR_FLOAT ? 4 : 8 ) / 1048576.0 );
+
+	/* the subnodes are all the same size, so solving every one of them, a solve of *
+	 * the whole fine grid, would cost the mean time of a subnode for each           */
+	if ( twolevel )
+	{
+		cint count = simproc->GetSubnodes();
+		double mean = solved / steps, full = ( solved > 0 ) ? nodetime / solved * count : 0.f;
+
+		printf( "\nsubnodes solved %.1f of %d a step, %.3f ms; all of them, the fine grid %dx%dx%d, about %.3f ms,"
+			" gating saves %.1f%%\n", mean, count, nodetime * 1000.0 / steps, 2 * nx, 2 * ny, 2 * nz, full * 1000.0,
+			( full > 0.f ) ? 100.0 * ( 1.0 - nodetime / steps / full ) : 0.f );
+	}
+
+	/* the writer catches up first, the solver is done */
+	if ( frames not_eq NULL )
+	{
+		simproc->StopExport();
+
+		const FrameExporter &exporter = simproc->GetExporter();
+		printf( "\nframes written %d, dropped %d, %.1f MB, the writer %.1f MB/s, the solver waited %.3f ms\n",
+			exporter.Written(), exporter.Dropped(), exporter.Bytes() / 1048576.0,
+			( exporter.WriteTime() > 0.f ) ? exporter.Bytes() / 1048576.0 / exporter.WriteTime() : 0.f,
+			exporter.Stall() * 1000.0 );
+	}
+
+	/* per frame, and the misses per thousand cells, which tell a stage bound by *
+	 * memory or by the TLB from one bound by its arithmetic                     */
+	const PerfCounters &perf = simproc->GetCounters();
+	if ( perf.IsOpen() )
+	{
+		double kcells = (double)( nx - 2 ) * ( ny - 2 ) * ( nz - 2 ) / 1e3;
+
+		printf( "\n%-10s %6s %12s %12s %6s %12s %12s %10s %10s\n", "stage", "calls", "Mcycles", "Minstr", "IPC",
+			"LLC misses", "dTLB misses", "LLC/kcell", "dTLB/kcell" );
+
+		for ( int i = 0; i < PERF_STAGES; i++ )
+		{
+			const unsigned long long *c = counts[i].counts;
+			if ( counts[i].calls eqt 0 ) continue;
+
+			printf( "%-10s %6.1f %12.2f %12.2f %6.2f %12.0f %12.0f %10.2f %10.2f\n", PerfCounters::StageName( i ),
+				(double)counts[i].calls / steps, c[PERF_CYCLES] / 1e6 / steps, c[PERF_INSTRUCTIONS] / 1e6 / steps,
+				( c[PERF_CYCLES] > 0 ) ? (double)c[PERF_INSTRUCTIONS] / c[PERF_CYCLES] : 0.f,
+				(double)c[PERF_LLC_MISSES] / steps, (double)c[PERF_DTLB_MISSES] / steps,
+				c[PERF_LLC_MISSES] / kcells / steps, c[PERF_DTLB_MISSES] / kcells / steps );
+		}
+
+		for ( int c = 0; c < PERF_COUNTERS; c++ )
+			if ( not perf.Has( c ) ) printf( "%s not counted, shown as 0\n", PerfCounters::Name( c ) );
+	}
+
+	if ( countcsv not_eq NULL ) fclose( countcsv );
+
+	if ( checkpoints > 0 )
+		printf( "\ncheckpoints %d, %s, the solver stalled %.3f ms on average, %.3f ms at most\n", checkpoints,
+			forked ? "forked" : "sync", stall * 1000.0 / checkpoints, maxstall * 1000.0 );
+
+	simproc->FreeResource();
+	delete simproc;
+
+	if ( trace not_eq NULL ) Tracer::Dump( trace );
+
+	return 0;
+};
@@ -0,0 +1,189 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     BrickMap.cpp
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <functional>
+#include "BrickMap.h"
+
+using namespace sge;
+
+
+BrickMap::BrickMap( cint nx, cint ny, cint nz, cint halo, cint slots )
+	: m_nx(nx), m_ny(ny), m_nz(nz), m_halo(halo),
+	m_bx(sge::Bricks( nx + 2 * halo )), m_by(sge::Bricks( ny + 2 * halo )), m_bz(sge::Bricks( nz + 2 * halo )),
+	m_slots( slots > 1 ? slots : 1 )
+{
+	for ( int n = 0; n < nx + 2 * halo; n++ )
+	{
+		m_brick.push_back( n >> BRICK_SHIFT );
+		m_cell.push_back( n & BRICK_MASK );
+	}
+	for ( int n = 0; n < ny + 2 * halo; n++ )
+	{
+		m_brick.push_back( ( n >> BRICK_SHIFT ) * m_bx );
+		m_cell.push_back( ( n & BRICK_MASK ) << BRICK_SHIFT );
+	}
+	for ( int n = 0; n < nz + 2 * halo; n++ )
+	{
+		m_brick.push_back( ( n >> BRICK_SHIFT ) * m_bx * m_by );
+		m_cell.push_back( ( n & BRICK_MASK ) << ( 2 * BRICK_SHIFT ) );
+	}
+
+	m_slot.assign( m_bx * m_by * m_bz, 0 );
+	m_pinned.assign( m_bx * m_by * m_bz, 0 );
+
+	/* handed out from the back, lowest slot first */
+	for ( int s = m_slots - 1; s > 0; s-- ) m_free.push_back( s );
+};
+
+
+void BrickMap::Pin( cint i, cint j, cint k )
+{
+	m_pinned[ BrickOf( i, j, k ) ] = 1;
+};
+
+
+template <typename T>
+bool BrickMap::Update( T **fields, cint count, cint tested, const T eps )
+{
+	cint bricks = Size();
+	std::vector<char> occupied( m_pinned ), keep( bricks, 0 );
+
+	/* only the active bricks can hold anything */
+	for ( size_t n = 0; n < m_active.size(); n++ )
+	{
+		cint b = m_active[n];
+		const size_t first = (size_t)m_slot[b] * BRICK_CELLS;
+
+		for ( int f = 0; f < tested and not occupied[b]; f++ )
+		{
+			for ( int c = 0; c < BRICK_CELLS; c++ )
+			{
+				const T x = fields[f][first + c];
+				if ( x > eps or x < -eps ) { occupied[b] = 1; break; }
+			}
+		}
+	}
+
+	/* the occupied bricks and their 26 neighbours */
+	for ( int b = 0; b < bricks; b++ )
+	{
+		if ( not occupied[b] ) continue;
+
+		cint bi = b % m_bx, bj = b / m_bx % m_by, bk = b / m_bx / m_by;
+
+		for ( int k = bk - 1; k <= bk + 1; k++ ) for ( int j = bj - 1; j <= bj + 1; j++ ) for ( int i = bi - 1; i <= bi + 1; i++ )
+		{
+			if ( i < 0 or j < 0 or k < 0 or i >= m_bx or j >= m_by or k >= m_bz ) continue;
+			keep[ ( k * m_by + j ) * m_bx + i ] = 1;
+		}
+	}
+
+	/* release the rest, a slot is handed out cleared */
+	for ( size_t n = 0; n < m_active.size(); n++ )
+	{
+		cint b = m_active[n];
+		if ( keep[b] ) continue;
+
+		for ( int f = 0; f < count; f++ )
+			memset( fields[f] + (size_t)m_slot[b] * BRICK_CELLS, 0, BRICK_CELLS * sizeof(T) );
+
+		m_free.push_back( m_slot[b] );
+		m_slot[b] = 0;
+	}
+
+	size_t needed = 0;
+	for ( int b = 0; b < bricks; b++ ) if ( keep[b] and m_slot[b] eqt 0 ) needed++;
+
+	/* grow by half at least, so that a spreading plume reallocates rarely */
+	bool grown = true;
+	if ( needed > m_free.size() )
+	{
+		int slots = m_slots + (int)( needed - m_free.size() );
+		if ( slots < m_slots + m_slots / 2 ) slots = m_slots + m_slots / 2;
+
+		for ( int f = 0; f < count and grown; f++ )
+		{
+			T *field = (T*) realloc( fields[f], (size_t)slots * BRICK_CELLS * sizeof(T) );
+			if ( field eqt NULL ) { grown = false; break; }
+
+			memset( field + Elements(), 0, (size_t)( slots - m_slots ) * BRICK_CELLS * sizeof(T) );
+			fields[f] = field;
+		}
+
+		if ( grown )
+		{
+			for ( int s = m_slots; s < slots; s++ ) m_free.push_back( s );
+			m_slots = slots;
+		}
+	}
+
+	/* on failure the fields grown so far just stay larger */
+	if ( grown )
+	{
+		/* lowest slot first, the active bricks stay packed at the front */
+		std::sort( m_free.begin(), m_free.end(), std::greater<int>() );
+
+		for ( int b = 0; b < bricks; b++ )
+		{
+			if ( not keep[b] or m_slot[b] not_eq 0 ) continue;
+			m_slot[b] = m_free.back();
+			m_free.pop_back();
+		}
+	}
+
+	m_active.clear();
+	for ( int b = 0; b < bricks; b++ ) if ( m_slot[b] not_eq 0 ) m_active.push_back( b );
+
+	return grown;
+};
+
+
+template <typename T>
+bool BrickMap::Restore( T **fields, cint count, const int *slot, cint slots )
+{
+	if ( slots < 1 ) return false;
+
+	for ( int f = 0; f < count; f++ )
+	{
+		T *field = (T*) realloc( fields[f], (size_t)slots * BRICK_CELLS * sizeof(T) );
+		if ( field eqt NULL ) return false;
+
+		if ( slots > m_slots )
+			memset( field + Elements(), 0, (size_t)( slots - m_slots ) * BRICK_CELLS * sizeof(T) );
+		fields[f] = field;
+	}
+
+	/* a failure above may leave some fields larger, which is harmless */
+	m_slots = slots;
+	m_slot.assign( slot, slot + Size() );
+
+	std::vector<char> used( slots, 0 );
+	m_active.clear();
+	for ( int b = 0; b < Size(); b++ )
+	{
+		if ( m_slot[b] eqt 0 ) continue;
+		m_active.push_back( b );
+		used[ m_slot[b] ] = 1;
+	}
+
+	/* handed out from the back, lowest slot first, as by the constructor */
+	m_free.clear();
+	for ( int s = slots - 1; s > 0; s-- ) if ( not used[s] ) m_free.push_back( s );
+
+	return true;
+};
+
+
+/* the storage precisions of FluidSimProc */
+template bool BrickMap::Update<float>( float **fields, cint count, cint tested, const float eps );
+template bool BrickMap::Update<double>( double **fields, cint count, cint tested, const double eps );
+template bool BrickMap::Restore<float>( float **fields, cint count, const int *slot, cint slots );
+template bool BrickMap::Restore<double>( double **fields, cint count, const int *slot, cint slots );
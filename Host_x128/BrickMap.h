@@ -0,0 +1,114 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     BrickMap.h
+*/
+
+#ifndef __brick_map_h_
+#define __brick_map_h_
+
+#include <stddef.h>
+#include <vector>
+#include "ISO646.h"
+
+/* bricks of 8 x 8 x 8 cells */
+#define BRICK_SHIFT 3
+#define BRICK_EDGE  ( 1 << BRICK_SHIFT )
+#define BRICK_MASK  ( BRICK_EDGE - 1 )
+#define BRICK_CELLS ( 1 << ( 3 * BRICK_SHIFT ) )
+
+namespace sge
+{
+	/* bricks needed to cover n cells */
+	inline int Bricks( cint n ) { return ( n + BRICK_MASK ) >> BRICK_SHIFT; };
+
+
+	/* sparse storage of a grid, ghosts included, in the manner of a VDB leaf level: *
+	 * only the active bricks own a slot of BRICK_CELLS elements in the fields, all  *
+	 * the others share slot 0, the zero brick, which is read but never written.     *
+	 * every field of the solver uses the same slots, so a brick is allocated or     *
+	 * released in all of them at once                                               */
+	class BrickMap
+	{
+	private:
+		int m_nx, m_ny, m_nz, m_halo;
+		int m_bx, m_by, m_bz;
+
+		/* per axis terms of the brick of a cell, x then y then z, ghosts included */
+		std::vector<int> m_brick;
+
+		/* per axis offsets of a cell within its brick, in the same order */
+		std::vector<int> m_cell;
+
+		/* slot of every brick, 0 for the inactive ones */
+		std::vector<int> m_slot;
+
+		/* bricks holding a slot, in increasing order, and the slots released since */
+		std::vector<int> m_active;
+		std::vector<int> m_free;
+
+		/* bricks kept active whatever they hold, the sources */
+		std::vector<char> m_pinned;
+
+		/* slots allocated in every field, the zero brick included */
+		int m_slots;
+
+	public:
+		BrickMap( cint nx, cint ny, cint nz, cint halo, cint slots );
+
+	public:
+		/* bricks of the whole grid, active or not */
+		int Size( void ) const { return (int)m_slot.size(); };
+
+		int Slots( void ) const { return m_slots; };
+
+		size_t Elements( void ) const { return (size_t)m_slots * BRICK_CELLS; };
+
+		const std::vector<int> &Active( void ) const { return m_active; };
+
+		/* first cell of a brick, which may be a ghost */
+		void Origin( cint brick, int &i, int &j, int &k ) const
+		{
+			i = ( brick % m_bx ) * BRICK_EDGE - m_halo;
+			j = ( brick / m_bx % m_by ) * BRICK_EDGE - m_halo;
+			k = ( brick / m_bx / m_by ) * BRICK_EDGE - m_halo;
+		};
+
+		/* the tables SparseLayout indexes with, offset to cell 0 of each axis */
+		const int *BrickTerms( cint axis ) const { return &m_brick[0] + Offset( axis ); };
+		const int *CellTerms( cint axis ) const { return &m_cell[0] + Offset( axis ); };
+		const int *SlotTable( void ) const { return &m_slot[0]; };
+
+		/* keep the brick of cell ( i, j, k ) active from the next Update on */
+		void Pin( cint i, cint j, cint k );
+
+		/* activate the bricks where one of the first tested fields exceeds eps in *
+		 * magnitude, or which are pinned, together with the band of bricks around *
+		 * them, and release all others; the released slots are cleared in all     *
+		 * count fields, which are grown with realloc when the slots run out.      *
+		 * false if the fields could not be grown, they are left as they were      */
+		template <typename T>
+		bool Update( T **fields, cint count, cint tested, const T eps );
+
+		/* take over the slots of a map saved with SlotTable and Slots, the count *
+		 * fields are grown or shrunk with realloc to hold them, the grown part    *
+		 * cleared; false if they could not be, the map is then left as it was   */
+		template <typename T>
+		bool Restore( T **fields, cint count, const int *slot, cint slots );
+
+	private:
+		int Offset( cint axis ) const
+		{
+			return m_halo + ( axis > 0 ? m_nx + 2 * m_halo : 0 ) + ( axis > 1 ? m_ny + 2 * m_halo : 0 );
+		};
+
+		int BrickOf( cint i, cint j, cint k ) const
+		{
+			return BrickTerms( 0 )[i] + BrickTerms( 1 )[j] + BrickTerms( 2 )[k];
+		};
+	};
+};
+
+#endif
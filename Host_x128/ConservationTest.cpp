@@ -0,0 +1,73 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 17, 2026
+* <Last Time>     Oct 17, 2026
+* <File Name>     ConservationTest.cpp
+*/
+
+#include <stdio.h>
+#include "MacroDefinition.h"
+#include "FluidSimProc.h"
+
+using namespace sge;
+
+/* steps run after the smoke is seeded, and how far the density sum may rise *
+ * above the first, semi-Lagrangian advection not conserving it exactly       */
+#define CHECK_STEPS     100
+#define CHECK_GAIN      0.01
+
+/* the smoke of a single step of the source, then none: the density sum of the *
+ * grid with its subnodes keeping their state and restricted back into it must *
+ * not grow past that of the first step                                        */
+static bool Conserves( cint extent, const SCALAR scalar, cint threads )
+{
+	FLUIDSPARAM fluid;
+	fluid.run = true;
+	fluid.volume.ptrData = NULL;
+
+	FluidSimProc *simproc = new FluidSimProc( &fluid, extent, extent, extent, scalar );
+	simproc->SetThreads( threads );
+	simproc->EnableSubnodes( &fluid, NODES_GATE, NODES_EXCHANGE );
+	simproc->SetNodeRestriction( true );
+
+	simproc->SourceSolver( DELTATIME );
+
+	double first = 0.f, last = 0.f, peak = 0.f;
+
+	for ( int n = 0; n < CHECK_STEPS; n++ )
+	{
+		simproc->VelocitySolver( DELTATIME );
+		simproc->DensitySolver( DELTATIME );
+		simproc->SolveNodeFlux();
+
+		last = simproc->ReduceDensity( REDUCE_SUM );
+
+		if ( n eqt 0 ) first = peak = last;
+		if ( last > peak ) peak = last;
+	}
+
+	bool passed = ( peak <= first * ( 1.0 + CHECK_GAIN ) );
+
+	printf( "%s %dx%dx%d, %s, %d threads: density sum %.6f, at most %.6f, after %d steps %.6f\n",
+		passed ? "pass" : "FAIL", extent, extent, extent, ( scalar eqt SCALAR_FLOAT ) ? "float" : "double",
+		simproc->GetThreads(), first, peak, CHECK_STEPS, last );
+
+	simproc->FreeResource();
+	delete simproc;
+
+	return passed;
+};
+
+
+int main( void )
+{
+	bool passed = true;
+
+	/* one thread and several, the subnodes then solved side by side, and both precisions */
+	passed = Conserves( 32, SCALAR_DOUBLE, 1 ) and passed;
+	passed = Conserves( 32, SCALAR_DOUBLE, 4 ) and passed;
+	passed = Conserves( 32, SCALAR_FLOAT, 4 ) and passed;
+
+	return passed ? 0 : 1;
+};
@@ -0,0 +1,182 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Exporter.cpp
+*/
+
+#include <string.h>
+#include "Exporter.h"
+#include "StopWatch.h"
+
+using namespace sge;
+
+
+FrameExporter::FrameExporter( void )
+	: m_quit(false), m_policy(EXPORT_BLOCK), m_nx(0), m_ny(0), m_nz(0), m_fields(0), m_file(NULL), m_failed(false),
+	m_written(0), m_dropped(0), m_bytes(0.f), m_writetime(0.f), m_stall(0.f)
+{
+};
+
+
+bool FrameExporter::Open( const char *path, cint nx, cint ny, cint nz, cint fields, cint depth,
+	const EXPORTPOLICY policy )
+{
+	Close();
+
+	m_file = fopen( path, "wb" );
+	if ( m_file eqt NULL ) return false;
+
+	/* the frames are large, the stdio buffer would only copy them once more */
+	setvbuf( m_file, NULL, _IONBF, 0 );
+
+	m_path = path;
+	m_nx = nx; m_ny = ny; m_nz = nz; m_fields = fields;
+	m_policy = policy;
+	m_failed = false;
+	m_written = m_dropped = 0;
+	m_bytes = m_writetime = m_stall = 0.f;
+	m_index.clear();
+
+	/* every buffer the exporter will ever use, allocated up front */
+	m_frames.assign( depth > 1 ? depth : 1, std::vector<float>( (size_t)nx * ny * nz * fields ) );
+	m_steps.assign( m_frames.size(), 0 );
+	m_free.clear();
+	m_ready.clear();
+	for ( int n = 0; n < (int)m_frames.size(); n++ ) m_free.push_back( n );
+
+	m_quit = false;
+	m_thread = std::thread( &FrameExporter::WriterLoop, this );
+
+	return true;
+};
+
+
+void FrameExporter::Close( void )
+{
+	if ( m_file eqt NULL ) return;
+
+	/* the writer drains the queue before it quits */
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_quit = true;
+	}
+	m_wake.notify_one();
+	m_thread.join();
+
+	fclose( m_file );
+	m_file = NULL;
+
+	/* the index goes last, it is complete or missing, never half written */
+	FILE *index = fopen( ( m_path + ".idx" ).c_str(), "wb" );
+	if ( index not_eq NULL )
+	{
+		EXPORTINDEX head;
+		memset( &head, 0, sizeof(head) );
+		memcpy( head.magic, INDEX_MAGIC, sizeof(head.magic) );
+		head.nx = m_nx; head.ny = m_ny; head.nz = m_nz; head.fields = m_fields;
+		head.frames  = (int)m_index.size();
+		head.dropped = m_dropped;
+
+		fwrite( &head, sizeof(head), 1, index );
+		if ( m_index.size() > 0 ) fwrite( &m_index[0], sizeof(EXPORTENTRY), m_index.size(), index );
+		fclose( index );
+	}
+	else printf( "write the index of %s failed\n", m_path.c_str() );
+
+	m_frames.clear();
+};
+
+
+int FrameExporter::Acquire( void )
+{
+	std::unique_lock<std::mutex> lock( m_mutex );
+
+	if ( m_free.empty() )
+	{
+		if ( m_policy eqt EXPORT_DROP )
+		{
+			m_dropped++;
+			return -1;
+		}
+
+		/* backpressure, the solver runs no faster than the disk */
+		StopWatch watch;
+		m_freed.wait( lock, [this]( void ) { return not m_free.empty(); } );
+		m_stall += watch.Elapsed();
+	}
+
+	int frame = m_free.front();
+	m_free.pop_front();
+	return frame;
+};
+
+
+void FrameExporter::Submit( cint frame, cint step )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_mutex );
+		m_steps[frame] = step;
+		m_ready.push_back( frame );
+	}
+	m_wake.notify_one();
+};
+
+
+void FrameExporter::WriterLoop( void )
+{
+	for ( ;; )
+	{
+		int frame;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			m_wake.wait( lock, [this]( void ) { return m_quit or not m_ready.empty(); } );
+
+			if ( m_ready.empty() ) return;
+
+			frame = m_ready.front();
+			m_ready.pop_front();
+		}
+
+		/* the buffer belongs to the writer until it is handed back */
+		StopWatch watch;
+
+		EXPORTFRAME head;
+		memset( &head, 0, sizeof(head) );
+		memcpy( head.magic, EXPORT_MAGIC, sizeof(head.magic) );
+		head.step = m_steps[frame];
+		head.nx = m_nx; head.ny = m_ny; head.nz = m_nz; head.fields = m_fields;
+		head.bytes = (long long)( m_frames[frame].size() * sizeof(float) );
+
+		EXPORTENTRY entry;
+		entry.step     = head.step;
+		entry.reserved = 0;
+		entry.offset   = (long long)m_bytes;
+
+		bool written = not m_failed and fwrite( &head, sizeof(head), 1, m_file ) eqt 1 and
+			fwrite( &m_frames[frame][0], sizeof(float), m_frames[frame].size(), m_file ) eqt m_frames[frame].size();
+
+		if ( not written and not m_failed )
+		{
+			printf( "write frame of step %d to %s failed, the frames after are dropped\n", head.step, m_path.c_str() );
+			m_failed = true;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock( m_mutex );
+
+			if ( written )
+			{
+				m_index.push_back( entry );
+				m_written++;
+				m_bytes += sizeof(head) + (double)head.bytes;
+			}
+			else m_dropped++;
+
+			m_writetime += watch.Elapsed();
+			m_free.push_back( frame );
+		}
+		m_freed.notify_one();
+	}
+};
@@ -0,0 +1,137 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Exporter.h
+*/
+
+#ifndef __exporter_h_
+#define __exporter_h_
+
+#include <stdio.h>
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "ISO646.h"
+
+/* first bytes of a frame of the raw file, and of its index */
+#define EXPORT_MAGIC "FRME"
+#define INDEX_MAGIC  "SGEINDEX"
+
+namespace sge
+{
+	/* what Acquire does when every buffer is queued, the disk falling behind */
+	enum EXPORTPOLICY
+	{
+		EXPORT_BLOCK = 0, // the solver waits for a buffer to be written, no frame is lost
+		EXPORT_DROP  = 1, // the frame is skipped, the solver never waits
+	};
+
+
+	/* head of every frame of the raw file, followed by bytes of floats, the *
+	 * fields one after the other, each nx * ny * nz cells in row order       */
+	struct EXPORTFRAME
+	{
+		char magic[4];
+		int  step;
+		int  nx, ny, nz, fields;
+		long long bytes;
+	};
+
+
+	/* the index written next to the raw file on Close, a head and one entry per *
+	 * frame, so that a reader seeks straight to any step                        */
+	struct EXPORTINDEX
+	{
+		char magic[8];
+		int  nx, ny, nz, fields;
+		int  frames, dropped;
+	};
+
+	struct EXPORTENTRY
+	{
+		int step, reserved;
+		long long offset; // of the EXPORTFRAME in the raw file
+	};
+
+
+	/* writes frames of the solver to disk on a thread of its own; the solver *
+	 * fills one of a fixed set of frame buffers, allocated once by Open, and *
+	 * queues it, the exporter writes it and hands the buffer back             */
+	class FrameExporter
+	{
+	private:
+		/* the buffers, and which of them are free and which wait to be written */
+		std::vector< std::vector<float> > m_frames;
+		std::vector<int> m_steps;
+		std::deque<int> m_free, m_ready;
+
+		std::thread m_thread;
+		std::mutex m_mutex;
+		std::condition_variable m_wake, m_freed;
+		bool m_quit;
+
+		EXPORTPOLICY m_policy;
+		int m_nx, m_ny, m_nz, m_fields;
+
+		/* the raw file, which takes no more frames after a failed write, *
+		 * as the offsets of the index would no longer hold               */
+		FILE *m_file;
+		bool m_failed;
+		std::string m_path;
+		std::vector<EXPORTENTRY> m_index;
+
+		/* frames written and dropped, bytes written, seconds the writer spent *
+		 * writing, and the solver waiting in Acquire                          */
+		int m_written, m_dropped;
+		double m_bytes, m_writetime, m_stall;
+
+	public:
+		FrameExporter( void );
+
+		~FrameExporter( void ) { Close(); };
+
+	public:
+		/* create the raw file at path, its index at path.idx, and depth buffers of *
+		 * fields fields of nx * ny * nz cells                                      */
+		bool Open( const char *path, cint nx, cint ny, cint nz, cint fields, cint depth, const EXPORTPOLICY policy );
+
+		/* write the frames still queued, then the index */
+		void Close( void );
+
+		bool IsOpen( void ) const { return m_file not_eq NULL; };
+
+		int Fields( void ) const { return m_fields; };
+
+		/* a free buffer for the next frame, waiting for one under EXPORT_BLOCK, *
+		 * -1 when there is none under EXPORT_DROP, the frame is then dropped     */
+		int Acquire( void );
+
+		float *Buffer( cint frame ) { return &m_frames[frame][0]; };
+
+		/* queue a filled buffer, for the frame of step */
+		void Submit( cint frame, cint step );
+
+		int Written( void ) const { return m_written; };
+
+		int Dropped( void ) const { return m_dropped; };
+
+		double Bytes( void ) const { return m_bytes; };
+
+		double WriteTime( void ) const { return m_writetime; };
+
+		double Stall( void ) const { return m_stall; };
+
+	private:
+		void WriterLoop( void );
+
+		FrameExporter( const FrameExporter& );
+		FrameExporter &operator=( const FrameExporter& );
+	};
+};
+
+#endif
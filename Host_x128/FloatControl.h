@@ -0,0 +1,59 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     FloatControl.h
+*/
+
+#ifndef __float_control_h_
+#define __float_control_h_
+
+#if defined(__SSE2__) or defined(_M_X64) or defined(_M_IX86)
+#include <xmmintrin.h>
+#define SSE_CONTROL 1
+#endif
+
+#include "ISO646.h"
+
+namespace sge
+{
+	/* control and status word of the SSE unit, 0 where there is none */
+	inline unsigned int GetFloatControl( void )
+	{
+#if defined(SSE_CONTROL)
+		return _mm_getcsr();
+#else
+		return 0;
+#endif
+	};
+
+
+	inline void SetFloatControl( const unsigned int csr )
+	{
+#if defined(SSE_CONTROL)
+		_mm_setcsr( csr );
+#endif
+	};
+
+
+	/* flush denormal results and operands to zero while in scope; the fading edges *
+	 * of a diffused field underflow quickly in float, and every denormal costs a    *
+	 * microcode assist of a hundred cycles or so                                   */
+	class DenormalsToZero
+	{
+	private:
+		unsigned int m_csr;
+
+	public:
+		explicit DenormalsToZero( const bool enable ) : m_csr( GetFloatControl() )
+		{
+			/* FTZ is bit 15, DAZ bit 6 */
+			if ( enable ) SetFloatControl( m_csr | 0x8040 );
+		};
+
+		~DenormalsToZero( void ) { SetFloatControl( m_csr ); };
+	};
+};
+
+#endif
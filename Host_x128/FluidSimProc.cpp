@@ -7,11 +7,18 @@
 */
 
 #include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <iostream>
+#include <sstream>
+#include <iomanip>
 #include <utility>
 #include "MacroDefinition.h"
 #include "FluidSimProc.h"
 #include "MacroDefinition.h"
+#include "StopWatch.h"
+#include "Trace.h"
 
 using namespace sge;
 using std::cout;
@@ -19,13 +26,19 @@ using std::endl;
 
 static int t_totaltimes = 0;
 
-static clock_t t_start, t_finish;
+static StopWatch t_watch;
 static double t_duration;
 
-static clock_t t_estart, t_efinish;
+static StopWatch t_ewatch;
 static double t_eduration;
 
-FluidSimProc::FluidSimProc( FLUIDSPARAM *fluid )
+FluidSimProc::FluidSimProc( FLUIDSPARAM *fluid, cint nx, cint ny, cint nz, const SCALAR scalar,
+	const STORAGE storage )
+	: m_scalar( scalar ), m_grid( nx, ny, nz, GRIDS_HALO, storage ), m_relax( RELAX_RED_BLACK ), m_simd( storage eqt STORAGE_ROWS ? DetectSimd() : SIMD_SCALAR ), m_depth( TEMPORAL_DEPTH ),
+	m_pressure( PRESSURE_JACOBI ), m_tolerance( 1e-4 ), m_maxcycles( 20 ), m_cycles( 0 ), m_residual( -1.f ), m_jacobiresidual( false ), m_projtime( 0.f ),
+	m_gate( NODES_GATE ), m_sync( NODES_INTERPOLATE ), m_restrict( false ), m_solved( 0 ), m_nodetime( 0.f ),
+	m_steps( 0 ), m_times( 0 ), m_ckperiod( 0.f ), m_cklast( 0.f ), m_child( -1 ), m_ckstep( 0 ), m_ckstart( 0.f ), m_stall( 0.f ),
+	m_savereq( false ), m_loadreq( false ), m_lastframe( 0.f )
 {
 	/* initialize FPS */
 	InitParams( fluid );
@@ -52,35 +65,70 @@ void FluidSimProc::InitParams( FLUIDSPARAM *fluid )
 	fluid->fps.dwLastUpdateTime = 0;
 	fluid->fps.uFPS             = 0;
 
-	srand(time(NULL));
+	/* the volume handed to the renderer has the extent of the grid */
+	fluid->volume.uWidth  = m_grid.nx;
+	fluid->volume.uHeight = m_grid.ny;
+	fluid->volume.uDepth  = m_grid.nz;
 
 	m_szTitle = APP_TITLE;
 
-	t_estart = clock();
+	t_ewatch.Start();
+};
+
+
+template <typename T>
+bool FluidSimProc::AllocateFields( const GridLayout &grid, FIELDS<T> &f )
+{
+	size_t cells = grid.Elements();
+
+	f.u = (T*) calloc ( cells, sizeof(T) );
+	f.v = (T*) calloc ( cells, sizeof(T) );
+	f.w = (T*) calloc ( cells, sizeof(T) );
+	f.u0 = (T*) calloc ( cells, sizeof(T) );
+	f.v0 = (T*) calloc ( cells, sizeof(T) );
+	f.w0 = (T*) calloc ( cells, sizeof(T) );
+	f.den = (T*) calloc ( cells, sizeof(T) );
+	f.den0 = (T*) calloc ( cells, sizeof(T) );
+	f.p = (T*) calloc ( cells, sizeof(T) );
+	f.obs = (T*) calloc ( cells, sizeof(T) );
+	f.div = (T*) calloc ( cells, sizeof(T) );
+	f.tmp = (T*) calloc ( cells, sizeof(T) );
+
+	if ( f.u eqt nullptr or f.v eqt nullptr or f.w eqt nullptr ) return false;
+	if ( f.u0 eqt nullptr or f.v0 eqt nullptr or f.w0 eqt nullptr ) return false;
+	if ( f.den eqt nullptr or f.den0 eqt nullptr ) return false;
+	if ( f.p eqt nullptr or f.obs eqt nullptr or f.div eqt nullptr ) return false;
+	if ( f.tmp eqt nullptr ) return false;
+
+	/* sparse grids relax the pressure, multigrid wants every cell */
+	if ( grid.storage not_eq STORAGE_SPARSE ) f.multigrid.Build( grid );
+
+	return true;
+};
+
+
+template <typename T>
+bool FluidSimProc::AllocateNodes( vector< FIELDS<T> > &nodes )
+{
+	nodes.resize( NODES_X * NODES_Y * NODES_Z );
+
+	for ( size_t n = 0; n < nodes.size(); n++ )
+		if ( not AllocateFields( m_node, nodes[n] ) ) return false;
+
+	return true;
 };
 
 
 void FluidSimProc::AllocateResource( void )
 {
-	
-	u = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	v = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	w = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	u0 = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	v0 = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	w0 = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	den = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	den0 = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	p = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	obs = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-	div = (double*) calloc ( 128 * 128 * 128, sizeof(double) );
-
-	visual = (uchar*) calloc ( 128 * 128 * 128, sizeof(uchar) );
-
-	if ( u eqt nullptr or v eqt nullptr or w eqt nullptr ) goto Error;
-	if ( u0 eqt nullptr or v0 eqt nullptr or w0 eqt nullptr ) goto Error;
-	if ( den eqt nullptr or den0 eqt nullptr ) goto Error;
-	if ( p eqt nullptr or obs eqt nullptr or div eqt nullptr ) goto Error;
+	bool created = false;
+
+	/* the fields of the other precision stay empty */
+	DISPATCH_FIELDS( created = AllocateFields( m_grid, fields ) );
+
+	visual = (uchar*) calloc ( m_grid.Cells(), sizeof(uchar) );
+
+	if ( not created ) goto Error;
 	if ( visual eqt nullptr ) goto Error;
 
 	goto Success;
@@ -91,37 +139,60 @@ Error:
 		exit(1);
 
 Success:
-		cout << "all resource created" << endl;
+		cout << "all resource created, grid "
+			<< m_grid.nx << " x " << m_grid.ny << " x " << m_grid.nz
+			<< ( m_scalar eqt SCALAR_FLOAT ? ", float" : ", double" ) << " fields"
+			<< ", " << m_pool.Threads() << " thread(s), " << SimdName( m_simd ) << endl;
+};
+
+
+template <typename T>
+void FluidSimProc::FreeFields( FIELDS<T> &f )
+{
+	SAFE_FREE_PTR( f.u );
+	SAFE_FREE_PTR( f.v );
+	SAFE_FREE_PTR( f.w );
+	SAFE_FREE_PTR( f.u0 );
+	SAFE_FREE_PTR( f.v0 );
+	SAFE_FREE_PTR( f.w0 );
+	SAFE_FREE_PTR( f.den );
+	SAFE_FREE_PTR( f.den0 );
+	SAFE_FREE_PTR( f.p );
+	SAFE_FREE_PTR( f.obs );
+	SAFE_FREE_PTR( f.div );
+	SAFE_FREE_PTR( f.tmp );
 };
 
 
 void FluidSimProc::FreeResource( void )
 {
-	SAFE_FREE_PTR( u );
-	SAFE_FREE_PTR( v );
-	SAFE_FREE_PTR( w );
-	SAFE_FREE_PTR( u0 );
-	SAFE_FREE_PTR( v0 );
-	SAFE_FREE_PTR( w0 );
-	SAFE_FREE_PTR( den );
-	SAFE_FREE_PTR( den0 );
-	SAFE_FREE_PTR( p );
-	SAFE_FREE_PTR( obs );
-	SAFE_FREE_PTR( div );
+	/* a checkpoint being written is still needed, and so are the queued frames */
+	WaitCheckpoint( true );
+	StopExport();
+
+	DISPATCH_FIELDS( FreeFields( fields ) );
+	for ( size_t n = 0; n < m_fnodes.size(); n++ ) FreeFields( m_fnodes[n] );
+	for ( size_t n = 0; n < m_dnodes.size(); n++ ) FreeFields( m_dnodes[n] );
 	SAFE_FREE_PTR( visual );
 
-	t_efinish = clock();
-	t_eduration = (double)( t_efinish - t_estart ) / CLOCKS_PER_SEC;
+	t_eduration = t_ewatch.Elapsed();
 
 	printf( "total duration: %f\n", t_eduration );
 }
 
 
-void FluidSimProc::RefreshStatus( FLUIDSPARAM *fluid )
+bool FluidSimProc::RefreshStatus( FLUIDSPARAM *fluid )
 {
+	double now = StopWatch::Now();
+	bool refreshed = false;
+
+	/* the time of every frame, the FPS below is only their mean */
+	if ( m_lastframe > 0.f ) m_latency[LATENCY_FRAME].Record( now - m_lastframe, now );
+	m_lastframe = now;
+
 	/* counting FPS */
 	fluid->fps.dwFrames ++;
-	fluid->fps.dwCurrentTime = GetTickCount();
+	fluid->fps.dwCurrentTime = (DWORD)( now * 1000.0 );
 	fluid->fps.dwElapsedTime = fluid->fps.dwCurrentTime - fluid->fps.dwLastUpdateTime;
 
 	/* 1 second */
@@ -130,53 +201,558 @@ void FluidSimProc::RefreshStatus( FLUIDSPARAM *fluid )
 		fluid->fps.uFPS     = fluid->fps.dwFrames * 1000 / fluid->fps.dwElapsedTime;
 		fluid->fps.dwFrames = 0;
 		fluid->fps.dwLastUpdateTime = fluid->fps.dwCurrentTime;
+
+		/* the tail of the frame times, which the mean hides */
+		LatencyHistogram frame = m_latency[LATENCY_FRAME].Window( now );
+
+		std::ostringstream status;
+		status << std::fixed << std::setprecision( 1 ) << APP_TITLE
+			<< "   frame p50 " << frame.Percentile( 50 ) * 1000.0 << "  p95 " << frame.Percentile( 95 ) * 1000.0
+			<< "  p99 " << frame.Percentile( 99 ) * 1000.0 << "  max " << frame.Max() * 1000.0
+			<< " ms   " << (unsigned int)fluid->fps.uFPS << " FPS";
+
+		std::lock_guard<std::mutex> lock( m_titlelock );
+		m_szTitle = status.str();
+		refreshed = true;
 	}
 
 	fluid->volume.ptrData = visual;
+	return refreshed;
 };
 
 
-void FluidSimProc::ClearBuffers( void )
+string FluidSimProc::GetTitle( void )
+{
+	std::lock_guard<std::mutex> lock( m_titlelock );
+	return m_szTitle;
+};
+
+
+void FluidSimProc::PrintLatency( void )
 {
-	for ( int k = 0; k < 128; k ++ ) for ( int j = 0; j < 128; j++ ) for ( int i = 0; i < 128; i++ )
+	double now = StopWatch::Now();
+
+	printf( "last %d s, p50/p95/p99/max ms:", LATENCY_WINDOW );
+
+	for ( int i = 0; i < LATENCY_STAGES; i++ )
 	{
-		u[ix(i,j,k)] = v[ix(i,j,k)] = w[ix(i,j,k)] = 0.f;
-		u0[ix(i,j,k)] = v0[ix(i,j,k)] = w0[ix(i,j,k)] = 0.f;
-		den[ix(i,j,k)] = den0[ix(i,j,k)] = 0.f;
-		p[ix(i,j,k)] = div[ix(i,j,k)] = obs[ix(i,j,k)] = 0.f;
-		
-		visual[ix(i,j,k)] = 0;
+		LatencyHistogram window = m_latency[i].Window( now );
+		if ( window.Count() eqt 0 ) continue;
+
+		printf( "  %s %.2f/%.2f/%.2f/%.2f", LatencyHistogram::StageName( i ), window.Percentile( 50 ) * 1000.0,
+			window.Percentile( 95 ) * 1000.0, window.Percentile( 99 ) * 1000.0, window.Max() * 1000.0 );
 	}
 
+	printf( "\n" );
+};
+
+
+template <class L, typename T>
+void FluidSimProc::ClearFields( const L &lay, FIELDS<T> &f )
+{
+	atomicCells( lay, [&]( int i, int j, int k )
+	{
+		f.u[lay.ix(i,j,k)] = f.v[lay.ix(i,j,k)] = f.w[lay.ix(i,j,k)] = 0.f;
+		f.u0[lay.ix(i,j,k)] = f.v0[lay.ix(i,j,k)] = f.w0[lay.ix(i,j,k)] = 0.f;
+		f.den[lay.ix(i,j,k)] = f.den0[lay.ix(i,j,k)] = 0.f;
+		f.p[lay.ix(i,j,k)] = f.div[lay.ix(i,j,k)] = f.obs[lay.ix(i,j,k)] = 0.f;
+	} );
+
+	memset( visual, 0, m_grid.Cells() * sizeof(uchar) );
+};
+
+
+void FluidSimProc::ClearBuffers( void )
+{
+	DISPATCH_FIELDS( DISPATCH_LAYOUT( m_grid, ClearFields( lay, fields ) ) );
+
 	cout << "call member function ClearBuffers success" << endl;
 }
 
 
 void FluidSimProc::InitBoundary( void )
 {
-	cint halfx = 128 / 2;
-	cint halfz = 128 / 2;
-
-	for ( int k = 0; k < 128; k ++ ) for ( int j = 0; j < 128; j++ ) for ( int i = 0; i < 128; i++ )
+	/* the sources of a sparse grid need bricks of their own before they are written */
+	if ( m_grid.storage eqt STORAGE_SPARSE )
 	{
-		if ( j < 4 and j > 0 and
-			i >= halfx - 2 and i < halfx + 2 and 
-			k >= halfz - 2 and k < halfz + 2 )
-			obs[ix(i,j,k)] = MACRO_BOUNDARY_SOURCE;
-		else
-			obs[ix(i,j,k)] = MACRO_BOUNDARY_BLANK;
+		for ( int k = 0; k < m_grid.nz; k ++ ) for ( int j = 0; j < m_grid.ny; j++ ) for ( int i = 0; i < m_grid.nx; i++ )
+			if ( IsSource( i, j, k ) ) m_grid.map->Pin( i, j, k );
+
+		UpdateBricks();
 	}
+
+	DISPATCH_FIELDS( DISPATCH_LAYOUT( m_grid, InitBoundary( lay, fields ) ) );
+
 	cout << "call member function InitBoundary success" << endl;
 };
 
 
+bool FluidSimProc::IsSource( cint i, cint j, cint k ) const
+{
+	cint halfx = m_grid.nx / 2;
+	cint halfz = m_grid.nz / 2;
+
+	return j < 4 and j > 0 and
+		i >= halfx - 2 and i < halfx + 2 and 
+		k >= halfz - 2 and k < halfz + 2;
+};
+
+
+template <class L, typename T>
+void FluidSimProc::InitBoundary( const L &lay, FIELDS<T> &f )
+{
+	atomicCells( lay, [&]( int i, int j, int k )
+	{
+		if ( IsSource( i, j, k ) )
+			f.obs[lay.ix(i,j,k)] = MACRO_BOUNDARY_SOURCE;
+		else
+			f.obs[lay.ix(i,j,k)] = MACRO_BOUNDARY_BLANK;
+	} );
+};
+
+
 void FluidSimProc::GenerVolumeImg( void )
 {
-	for ( int k = 0; k < 128; k ++ ) for ( int j = 0; j < 128; j++ ) for ( int i = 0; i < 128; i++ )
+	TraceScope trace( "volume", m_steps - 1 );
+	PerfScope perf( m_perf, m_perfstage[PERF_VOLUME] );
+	LatencyScope latency( m_latency[LATENCY_VOLUME] );
+
+	if ( HasSubnodes() )
 	{
-		visual[ix(i,j,k)] = ( den[ix(i,j,k)] > 0.f and den[ix(i,j,k)] < 250.f ) ? 
-			(uchar)den[ix(i,j,k)] : 0;
+		DISPATCH_NODES( GenerNodeVolume( nodes ) );
 	}
+	else
+	{
+		DISPATCH_FIELDS( DISPATCH_LAYOUT( m_grid, GenerVolumeImg( lay, fields ) ) );
+	}
+};
+
+
+template <class L, typename T>
+void FluidSimProc::GenerVolumeImg( const L &lay, FIELDS<T> &f )
+{
+	/* a sparse grid only visits its active bricks, the rest of the volume is empty */
+	if ( m_grid.storage eqt STORAGE_SPARSE ) memset( visual, 0, m_grid.Cells() * sizeof(uchar) );
+
+	kernelVolume( lay, visual, f.den );
+};
+
+
+bool FluidSimProc::EnableCounters( const bool on )
+{
+	if ( not on )
+	{
+		m_perf.Close();
+		return true;
+	}
+
+	if ( not m_perf.Open() )
+	{
+		printf( "hardware counters unavailable: %s\n", m_perf.Error( PERF_CYCLES ).c_str() );
+		return false;
+	}
+
+	for ( int c = 0; c < PERF_COUNTERS; c++ )
+		if ( not m_perf.Has( c ) ) printf( "%s not counted: %s\n", PerfCounters::Name( c ), m_perf.Error( c ).c_str() );
+
+	ResetCounters();
+	return true;
+};
+
+
+bool FluidSimProc::StartExport( const char *path, const bool velocity, cint depth, const EXPORTPOLICY policy )
+{
+	if ( not m_exporter.Open( path, m_grid.nx, m_grid.ny, m_grid.nz, velocity ? 4 : 1, depth, policy ) )
+	{
+		printf( "open %s for the frames failed\n", path );
+		return false;
+	}
+
+	return true;
+};
+
+
+void FluidSimProc::ExportFrame( void )
+{
+	if ( not m_exporter.IsOpen() ) return;
+
+	TraceScope trace( "export", m_steps - 1 );
+
+	/* EXPORT_DROP loses the frame while the writer is behind */
+	cint frame = m_exporter.Acquire();
+	if ( frame < 0 ) return;
+
+	DISPATCH_FIELDS( DISPATCH_LAYOUT( m_grid, ExportFrame( lay, fields, m_exporter.Buffer( frame ) ) ) );
+
+	m_exporter.Submit( frame, m_steps );
+};
+
+
+template <class L, typename T>
+void FluidSimProc::ExportFrame( const L &lay, FIELDS<T> &f, float *out )
+{
+	/* packed in rows like the volume, the density, then u, v and w */
+	const T *fields[] = { f.den, f.u, f.v, f.w };
+	const size_t cells = m_grid.Cells();
+	cint count = m_exporter.Fields();
+
+	if ( m_grid.storage eqt STORAGE_SPARSE ) memset( out, 0, cells * count * sizeof(float) );
+
+	atomicCells( lay, [&]( int i, int j, int k )
+	{
+		const size_t n = ( (size_t)k * m_grid.ny + j ) * m_grid.nx + i;
+		for ( int c = 0; c < count; c++ ) out[ c * cells + n ] = (float)fields[c][ lay.ix(i,j,k) ];
+	} );
+};
+
+
+template <typename T>
+void FluidSimProc::GenerNodeVolume( vector< FIELDS<T> > &nodes )
+{
+	/* the interiors of the subnodes tile the fine grid; those NODES_EXCHANGE *
+	 * leaves unsolved hold a stale state, and less smoke than the gate       */
+	cint nx = m_node.nx - 2, ny = m_node.ny - 2, nz = m_node.nz - 2;
+
+	for ( int n = 0; n < (int)nodes.size(); n++ )
+	{
+		const T *den = nodes[n].den;
+		const bool empty = ( m_sync eqt NODES_EXCHANGE and not m_active[n] );
+		int oi, oj, ok;
+		NodeOrigin( n, oi, oj, ok );
+
+		for ( int k = 1; k <= nz; k++ ) for ( int j = 1; j <= ny; j++ ) for ( int i = 1; i <= nx; i++ )
+		{
+			visual[ ( (size_t)( ok + k - 1 ) * m_fine.ny + oj + j - 1 ) * m_fine.nx + oi + i - 1 ] = ( not empty and
+				den[m_node.ix(i,j,k)] > 0.f and den[m_node.ix(i,j,k)] < 250.f ) ? (uchar)den[m_node.ix(i,j,k)] : 0;
+		}
+	}
+};
+
+
+double FluidSimProc::ReduceDensity( const REDUCTION op )
+{
+	double result = 0.f;
+
+	DISPATCH_FIELDS( DISPATCH_LAYOUT( m_grid, result = kernelReduce( lay, m_pool, op, fields.den, 1 ) ) );
+
+	return result;
+};
+
+
+void FluidSimProc::EnableSubnodes( FLUIDSPARAM *fluid, cdouble gate, const NODESYNC sync )
+{
+	bool created = false;
+
+	m_gate = gate;
+	m_sync = sync;
+
+	/* each subnode takes an equal share of the fine grid, plus its shell */
+	m_fine = GridLayout( 2 * m_grid.nx, 2 * m_grid.ny, 2 * m_grid.nz );
+	m_node = GridLayout( m_fine.nx / NODES_X + 2, m_fine.ny / NODES_Y + 2, m_fine.nz / NODES_Z + 2, GRIDS_HALO );
+
+	if ( m_fine.nx % NODES_X not_eq 0 or m_fine.ny % NODES_Y not_eq 0 or m_fine.nz % NODES_Z not_eq 0 )
+	{
+		printf( "grid %d x %d x %d cannot be split into %d x %d x %d subnodes\n",
+			m_grid.nx, m_grid.ny, m_grid.nz, NODES_X, NODES_Y, NODES_Z );
+		FreeResource();
+		exit(1);
+	}
+
+	DISPATCH_NODES( created = AllocateNodes( nodes ) );
+
+	SAFE_FREE_PTR( visual );
+	visual = (uchar*) calloc ( m_fine.Cells(), sizeof(uchar) );
+
+	if ( not created or visual eqt nullptr )
+	{
+		cout << "create subnodes for host failed" << endl;
+		FreeResource();
+		exit(1);
+	}
+
+	m_nodesum.assign( NODES_X * NODES_Y * NODES_Z, 0.f );
+	m_active.assign( NODES_X * NODES_Y * NODES_Z, 0 );
+
+	DISPATCH_NODES( InitNodeBoundary( nodes ) );
+
+	/* the renderer gets the fine volume */
+	fluid->volume.uWidth  = m_fine.nx;
+	fluid->volume.uHeight = m_fine.ny;
+	fluid->volume.uDepth  = m_fine.nz;
+
+	cout << "subnodes created, " << NODES_X << " x " << NODES_Y << " x " << NODES_Z << " of "
+		<< m_node.nx << " x " << m_node.ny << " x " << m_node.nz << ", fine grid "
+		<< m_fine.nx << " x " << m_fine.ny << " x " << m_fine.nz
+		<< ( m_sync eqt NODES_EXCHANGE ? ", halo exchange" : ", interpolated" ) << endl;
+};
+
+
+template <typename T>
+void FluidSimProc::InitNodeBoundary( vector< FIELDS<T> > &nodes )
+{
+	for ( int n = 0; n < (int)nodes.size(); n++ )
+	{
+		int oi, oj, ok;
+		NodeOrigin( n, oi, oj, ok );
+
+		for ( int k = 0; k < m_node.nz; k++ ) for ( int j = 0; j < m_node.ny; j++ ) for ( int i = 0; i < m_node.nx; i++ )
+		{
+			cint x = oi + i - 1, y = oj + j - 1, z = ok + k - 1;
+			const bool inside = ( x >= 0 and y >= 0 and z >= 0 and x < m_fine.nx and y < m_fine.ny and z < m_fine.nz );
+
+			nodes[n].obs[m_node.ix(i,j,k)] = ( inside and IsSource( x / 2, y / 2, z / 2 ) ) ?
+				MACRO_BOUNDARY_SOURCE : MACRO_BOUNDARY_BLANK;
+		}
+	}
+};
+
+
+void FluidSimProc::SolveGlobalFlux( void )
+{
+	SourceSolver( DELTATIME );
+	VelocitySolver( DELTATIME );
+	DensitySolver( DELTATIME );
+};
+
+
+void FluidSimProc::InterpolationData( void )
+{
+	if ( m_scalar eqt SCALAR_FLOAT )
+		InterpolationData( m_ffields, m_fnodes );
+	else
+		InterpolationData( m_dfields, m_dnodes );
+};
+
+
+template <typename T>
+void FluidSimProc::InterpolationData( FIELDS<T> &global, vector< FIELDS<T> > &nodes )
+{
+	/* the subnodes sample the global grid independently, a task each; the velocity *
+	 * of a subnode is only ever read by its solve, so those below the gate go      *
+	 * without                                                                      */
+	TaskGroup group;
+
+	for ( int n = 0; n < (int)nodes.size(); n++ )
+	{
+		m_pool.Spawn( group, [this, &global, &nodes, n]( void )
+		{
+			const T *in[] = { global.den, global.u, global.v, global.w };
+			T *out[] = { nodes[n].den, nodes[n].u, nodes[n].v, nodes[n].w };
+			int oi, oj, ok;
+			NodeOrigin( n, oi, oj, ok );
+
+			DISPATCH_LAYOUT( m_grid, kernelUpScaling( lay, m_node, out, in, 1, oi, oj, ok ) );
+
+			/* the gate of SolveNodeFlux, summed over the shell too, the same for any *
+			 * number of threads so the same subnodes are solved                      */
+			m_nodesum[n] = kernelReduce( m_node, m_pool, REDUCE_SUM, nodes[n].den, 0 );
+
+			if ( IsGated( n ) )
+			{
+				DISPATCH_LAYOUT( m_grid, kernelUpScaling( lay, m_node, out + 1, in + 1, 3, oi, oj, ok ) );
+			}
+		} );
+	}
+
+	m_pool.Wait( group );
+};
+
+
+void FluidSimProc::SyncNodes( void )
+{
+	if ( m_scalar eqt SCALAR_FLOAT )
+		SyncNodes( m_ffields, m_fnodes );
+	else
+		SyncNodes( m_dfields, m_dnodes );
+};
+
+
+template <typename T>
+void FluidSimProc::SyncNodes( FIELDS<T> &global, vector< FIELDS<T> > &nodes )
+{
+	/* offsets of the six neighbours, as ExchangeHalos */
+	const int ni[] = { -1, 1, 0, 0, 0, 0 }, nj[] = { 0, 0, -1, 1, 0, 0 }, nk[] = { 0, 0, 0, 0, -1, 1 };
+	cint size[] = { m_node.nx, m_node.ny, m_node.nz };
+
+	TaskGroup group;
+
+	for ( int n = 0; n < (int)nodes.size(); n++ )
+	{
+		m_pool.Spawn( group, [&, n]( void )
+		{
+			int oi, oj, ok;
+			NodeOrigin( n, oi, oj, ok );
+
+			if ( m_active[n] )
+			{
+				m_nodesum[n] = kernelReduce( m_node, m_pool, REDUCE_SUM, nodes[n].den, 0 );
+			}
+			else
+			{
+				/* the global cells under the subnode and its shell, each upsampled *
+				 * into eight fine cells, stand in for the sum InterpolationData    *
+				 * would take without writing a single fine cell                    */
+				cint i0 = ( oi > 0 ) ? ( oi - 1 ) / 2 : 0, i1 = ( oi + m_node.nx - 2 ) / 2 + 1;
+				cint j0 = ( oj > 0 ) ? ( oj - 1 ) / 2 : 0, j1 = ( oj + m_node.ny - 2 ) / 2 + 1;
+				cint k0 = ( ok > 0 ) ? ( ok - 1 ) / 2 : 0, k1 = ( ok + m_node.nz - 2 ) / 2 + 1;
+
+				DISPATCH_LAYOUT( m_grid, m_nodesum[n] = 8.0 * kernelReduceBox( lay, m_pool, REDUCE_SUM, global.den,
+					i0, i1 < m_grid.nx ? i1 : m_grid.nx, j0, j1 < m_grid.ny ? j1 : m_grid.ny,
+					k0, k1 < m_grid.nz ? k1 : m_grid.nz ) );
+			}
+
+			if ( not IsGated( n ) ) return;
+
+			const T *in[] = { global.den, global.u, global.v, global.w };
+			T *out[] = { nodes[n].den, nodes[n].u, nodes[n].v, nodes[n].w };
+
+			/* a subnode turning active starts from the global grid, halo included */
+			if ( not m_active[n] )
+			{
+				DISPATCH_LAYOUT( m_grid, kernelUpScaling( lay, m_node, out, in, 4, oi, oj, ok ) );
+				return;
+			}
+
+			/* one staying active keeps its interior, but ExchangeHalos only fills the *
+			 * faces towards active neighbours, edges and corners excluded; the rest  *
+			 * of the shell would hold the fields of the step it turned active and    *
+			 * flow back in, so it is sampled from the global grid again              */
+			cint a = n % NODES_X, b = n / NODES_X % NODES_Y, c = n / NODES_X / NODES_Y;
+
+			for ( int face = 0; face < 6; face++ )
+			{
+				cint na = a + ni[face], nb = b + nj[face], nc = c + nk[face];
+				const bool exchanged = na >= 0 and nb >= 0 and nc >= 0 and na < NODES_X and nb < NODES_Y and nc < NODES_Z
+					and m_active[ ( nc * NODES_Y + nb ) * NODES_X + na ];
+
+				cint axis = face / 2, dst = ( face % 2 ) ? size[axis] - 1 : 0;
+				cint ua = ( axis eqt 0 ) ? 1 : 0, va = ( axis eqt 2 ) ? 1 : 2;
+
+				/* the whole shell plane, or of an exchanged one its four edge strips */
+				int lo[3], hi[3];
+				lo[axis] = dst; hi[axis] = dst + 1;
+
+				for ( int strip = 0; strip < ( exchanged ? 4 : 1 ); strip++ )
+				{
+					cint sa = ( strip < 2 ) ? ua : va, sb = ( strip < 2 ) ? va : ua;
+					lo[sb] = 0; hi[sb] = size[sb];
+					lo[sa] = 0; hi[sa] = size[sa];
+
+					if ( exchanged )
+					{
+						lo[sa] = ( strip % 2 ) ? size[sa] - 1 : 0;
+						hi[sa] = lo[sa] + 1;
+					}
+
+					DISPATCH_LAYOUT( m_grid, kernelUpScaling( lay, m_node, out, in, 4, oi, oj, ok,
+						lo[0], hi[0], lo[1], hi[1], lo[2], hi[2] ) );
+				}
+			}
+
+			/* the source of this step, SourceSolver applied once to the global grid *
+			 * on the calling thread, so the tasks never touch m_times               */
+			for ( int k = 1; k < m_node.nz - 1; k++ ) for ( int j = 1; j < m_node.ny - 1; j++ ) for ( int i = 1; i < m_node.nx - 1; i++ )
+			{
+				if ( nodes[n].obs[ m_node.ix(i,j,k) ] < 0.f )
+				{
+					DISPATCH_LAYOUT( m_grid, kernelUpScaling( lay, m_node, out, in, 4, oi, oj, ok, i, i + 1, j, j + 1, k, k + 1 ) );
+				}
+			}
+		} );
+	}
+
+	m_pool.Wait( group );
+};
+
+
+void FluidSimProc::ExchangeHalos( void )
+{
+	DISPATCH_NODES( ExchangeHalos( nodes ) );
+};
+
+
+template <typename T>
+void FluidSimProc::ExchangeHalos( vector< FIELDS<T> > &nodes )
+{
+	/* offsets of the six neighbours, and the axis and side of the face towards each */
+	const int ni[] = { -1, 1, 0, 0, 0, 0 }, nj[] = { 0, 0, -1, 1, 0, 0 }, nk[] = { 0, 0, 0, 0, -1, 1 };
+	cint size[] = { m_node.nx, m_node.ny, m_node.nz };
+
+	TaskGroup group;
+
+	for ( int n = 0; n < (int)nodes.size(); n++ )
+	{
+		if ( not m_active[n] ) continue;
+
+		m_pool.Spawn( group, [&, n]( void )
+		{
+			cint a = n % NODES_X, b = n / NODES_X % NODES_Y, c = n / NODES_X / NODES_Y;
+
+			for ( int face = 0; face < 6; face++ )
+			{
+				cint na = a + ni[face], nb = b + nj[face], nc = c + nk[face];
+				if ( na < 0 or nb < 0 or nc < 0 or na >= NODES_X or nb >= NODES_Y or nc >= NODES_Z ) continue;
+
+				cint m = ( nc * NODES_Y + nb ) * NODES_X + na;
+				if ( not m_active[m] ) continue;
+
+				/* the shell plane of this side takes the last interior plane of the *
+				 * neighbour on the far side of it, the edges and corners excluded   */
+				cint axis = face / 2, upper = face % 2, last = size[axis] - 1;
+				cint dst = upper ? last : 0, src = upper ? 1 : last - 1;
+				cint ua = ( axis eqt 0 ) ? 1 : 0, va = ( axis eqt 2 ) ? 1 : 2;
+
+				T *to[] = { nodes[n].den, nodes[n].u, nodes[n].v, nodes[n].w };
+				const T *from[] = { nodes[m].den, nodes[m].u, nodes[m].v, nodes[m].w };
+
+				for ( int v = 1; v < size[va] - 1; v++ ) for ( int u = 1; u < size[ua] - 1; u++ )
+				{
+					int d[3], s[3];
+					d[axis] = dst; d[ua] = u; d[va] = v;
+					s[axis] = src; s[ua] = u; s[va] = v;
+
+					for ( int f = 0; f < 4; f++ )
+						to[f][ m_node.ix( d[0], d[1], d[2] ) ] = from[f][ m_node.ix( s[0], s[1], s[2] ) ];
+				}
+			}
+		} );
+	}
+
+	m_pool.Wait( group );
+};
+
+
+void FluidSimProc::RestrictNodes( void )
+{
+	if ( m_scalar eqt SCALAR_FLOAT )
+		RestrictNodes( m_ffields, m_fnodes );
+	else
+		RestrictNodes( m_dfields, m_dnodes );
+};
+
+
+template <typename T>
+void FluidSimProc::RestrictNodes( FIELDS<T> &global, vector< FIELDS<T> > &nodes )
+{
+	/* the subnodes cover disjoint global cells, a task each */
+	TaskGroup group;
+
+	for ( int n = 0; n < (int)nodes.size(); n++ )
+	{
+		if ( not m_active[n] ) continue;
+
+		m_pool.Spawn( group, [this, &global, &nodes, n]( void )
+		{
+			const T *in[] = { nodes[n].den, nodes[n].u, nodes[n].v, nodes[n].w };
+			T *out[] = { global.den, global.u, global.v, global.w };
+			int oi, oj, ok;
+			NodeOrigin( n, oi, oj, ok );
+
+			DISPATCH_LAYOUT( m_grid, kernelDownScaling( lay, m_node, out, in, 4, oi, oj, ok ) );
+		} );
+	}
+
+	m_pool.Wait( group );
 };
 
 
@@ -184,6 +760,18 @@ void FluidSimProc::FluidSimSolver( FLUIDSPARAM *fluid )
 {
 	if ( not fluid->run ) return;
 
+	TraceScope trace( "step", m_steps );
+
+	/* between two steps, where the fields hold a whole state */
+	if ( m_ckperiod > 0.f and StopWatch::Now() - m_cklast >= m_ckperiod )
+	{
+		m_cklast = StopWatch::Now();
+		ForkCurStage( m_ckpath.c_str() );
+	}
+
+	if ( m_savereq.exchange( false ) ) SaveCurStage();
+	if ( m_loadreq.exchange( false ) ) LoadPreStage();
+
 //	if( t_totaltimes > TIMES ) 
 //	{
 //		FreeResource();
@@ -192,32 +780,59 @@ void FluidSimProc::FluidSimSolver( FLUIDSPARAM *fluid )
 //
 	printf( "%d   ", t_totaltimes );
 
+	if ( HasSubnodes() )
+	{
+		/* duration of the global grid */
+		t_watch.Start();
+		SolveGlobalFlux();
+		t_duration = t_watch.Elapsed();
+		printf( "%f ", t_duration );
+
+		/* duration of the subnodes */
+		t_watch.Start();
+		SolveNodeFlux();
+		t_duration = t_watch.Elapsed();
+		printf( "%f ", t_duration );
+
+		GenerVolumeImg();
+		ExportFrame();
+		bool refreshed = RefreshStatus( fluid );
+		printf( "%d", fluid->fps.uFPS );
+
+		t_totaltimes++;
+
+		printf("\n");
+
+		/* the title bar shows them otherwise */
+#if defined(HEADLESS)
+		if ( refreshed ) PrintLatency();
+#endif
+		return;
+	}
+
 	/* duration of adding source */
-	t_start = clock();
+	t_watch.Start();
 	SourceSolver( DELTATIME );
-	t_finish = clock();
-	t_duration = (double)( t_finish - t_start ) / CLOCKS_PER_SEC;
+	t_duration = t_watch.Elapsed();
 	printf( "%f ", t_duration );
 
 	/* duration of velocity solver */
-	t_start = clock();
+	t_watch.Start();
 	VelocitySolver( DELTATIME );
-	t_finish = clock();
-	t_duration = (double)( t_finish - t_start ) / CLOCKS_PER_SEC;
+	t_duration = t_watch.Elapsed();
 	printf( "%f ", t_duration );
 
 	/* duration of density solver */
-	t_start = clock();
+	t_watch.Start();
 	DensitySolver( DELTATIME );
-	t_finish = clock();
-	t_duration = (double)( t_finish - t_start ) / CLOCKS_PER_SEC;
+	t_duration = t_watch.Elapsed();
 	printf( "%f ", t_duration );
 
-	t_start = clock();
+	t_watch.Start();
 	GenerVolumeImg();	
-	RefreshStatus( fluid );
-	t_finish = clock();
-	t_duration = (double)( t_finish - t_start ) / CLOCKS_PER_SEC;
+	ExportFrame();
+	bool refreshed = RefreshStatus( fluid );
+	t_duration = t_watch.Elapsed();
 	printf( "%f ", t_duration );
 	
 	/* FPS */
@@ -226,4 +841,8 @@ void FluidSimProc::FluidSimSolver( FLUIDSPARAM *fluid )
 	t_totaltimes++;
 
 	printf("\n");
+
+#if defined(HEADLESS)
+	if ( refreshed ) PrintLatency();
+#endif
 };
\ No newline at end of file
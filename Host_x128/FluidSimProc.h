@@ -10,11 +10,25 @@
 #ifndef __fluid_simulation_process_h_
 #define __fluid_simulation_process_h_
 
+#if defined(HEADLESS)
+#include "Headless.h"
+#else
 #include <GL\glew.h>
 #include <GL\freeglut.h>
 #include <SGE\SGUtils.h>
-#include <vector>
 #include "FrameworkDynamic.h"
+#endif
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include "Exporter.h"
+#include "GridLayout.h"
+#include "Histogram.h"
+#include "Kernels.h"
+#include "Multigrid.h"
+#include "PerfCounters.h"
+#include "Simd.h"
+#include "ThreadPool.h"
 #include "ISO646.h"
 
 using std::vector;
@@ -22,24 +36,270 @@ using std::string;
 
 namespace sge
 {	
+	/* storage precision of the simulation fields */
+	enum SCALAR
+	{
+		SCALAR_DOUBLE = 0, // the original
+		SCALAR_FLOAT  = 1, // half the memory traffic, reductions are still summed in double
+	};
+
+
+	/* how the subnodes of the two-level scheme get their state every step */
+	enum NODESYNC
+	{
+		NODES_INTERPOLATE = 0, // upsampled from the global grid, as Speedup_x128 does
+		NODES_EXCHANGE    = 1, // kept across steps, only the face halos pass between neighbours
+	};
+
+
+	/* the fields of the solver in one storage precision */
+	template <typename T>
+	struct FIELDS
+	{
+		T *u, *v, *w, *u0, *v0, *w0;
+		T *den, *den0, *p, *obs, *div;
+
+		/* scratch field of the ping-pong Jacobi relaxation */
+		T *tmp;
+
+		/* the pressure solve works in the same precision */
+		Multigrid<T> multigrid;
+
+		FIELDS( void ) : u(NULL), v(NULL), w(NULL), u0(NULL), v0(NULL), w0(NULL),
+			den(NULL), den0(NULL), p(NULL), obs(NULL), div(NULL), tmp(NULL) {};
+	};
+
+
 	class FluidSimProc
 	{
 	private:
-		double *u, *v, *w, *u0, *v0, *w0;
-		double *den, *den0, *p, *obs, *div;
+		/* only the fields of the chosen precision are allocated */
+		SCALAR         m_scalar;
+		FIELDS<float>  m_ffields;
+		FIELDS<double> m_dfields;
 
 		SGUCHAR *visual;			
 
+		/* the title, rewritten by the solver once a second and read by the window */
 		string m_szTitle;
+		std::mutex m_titlelock;
+
+		/* extent of the simulation domain, chosen at startup */
+		GridLayout m_grid;
+
+		/* workers of the multithreaded stencils */
+		ThreadPool m_pool;
+
+		RELAXATION m_relax;
+
+		/* vector instruction set of the stencils */
+		SIMD m_simd;
+
+		/* Jacobi sweeps per pass over the grid, 0 sweeps the whole grid each time */
+		int m_depth;
+
+		/* pressure solve of Projection */
+		PRESSURESOLVER m_pressure;
+		double m_tolerance;
+		int    m_maxcycles;
+
+		/* V-cycles spent by all projections so far, and residual of the last one */
+		int    m_cycles;
+		double m_residual;
+
+		/* whether PRESSURE_JACOBI measures its residual as well */
+		bool   m_jacobiresidual;
+
+		/* seconds spent by all projections of the grid so far */
+		double m_projtime;
+
+		/* subnodes of the two-level scheme, empty unless EnableSubnodes was called; *
+		 * m_node is the grid of each, its interior plus a shell taken from the      *
+		 * neighbours, m_fine the grid they cut up                                   */
+		GridLayout m_node, m_fine;
+		vector< FIELDS<float> >  m_fnodes;
+		vector< FIELDS<double> > m_dnodes;
+
+		/* density summed over each subnode, and the gate it has to exceed */
+		vector<double> m_nodesum;
+		double m_gate;
+
+		/* the subnodes solved by the last step, which NODES_EXCHANGE keeps the state of */
+		NODESYNC m_sync;
+		vector<char> m_active;
+
+		/* the solved subnodes averaged back into the global grid after each step */
+		bool m_restrict;
+
+		/* subnodes solved by the last SolveNodeFlux, and its time spent solving them */
+		int    m_solved;
+		double m_nodetime;
+
+		/* steps solved by the grid, and source cells fed so far, which stop at 10 */
+		int m_steps;
+		int m_times;
+
+		/* checkpoints taken by FluidSimSolver every m_ckperiod seconds, 0 for never */
+		string m_ckpath;
+		double m_ckperiod, m_cklast;
+
+		/* the child process writing the last checkpoint, the file, the step it holds *
+		 * and when it was forked, and how long the solver stood still for the last   */
+		int    m_child, m_ckstep;
+		string m_ckfile;
+		double m_ckstart, m_stall;
+
+		/* a save or load of SNAPSHOT_FILE asked for by another thread, done by *
+		 * FluidSimSolver between two steps                                     */
+		std::atomic<bool> m_savereq, m_loadreq;
+
+		/* frames of the density, and the velocity, written out after every step */
+		FrameExporter m_exporter;
+
+		/* hardware counters of the stages of the grid, summed since ResetCounters */
+		PerfCounters m_perf;
+		PERFSAMPLE   m_perfstage[PERF_STAGES];
+
+		/* frame and stage times of the last LATENCY_WINDOW seconds, and when the *
+		 * last frame was done                                                     */
+		SlidingHistogram m_latency[LATENCY_STAGES];
+		double m_lastframe;
 
 	public:
-		FluidSimProc( FLUIDSPARAM *fluid );
+		FluidSimProc( FLUIDSPARAM *fluid,
+			cint nx = GRIDS_X, cint ny = GRIDS_Y, cint nz = GRIDS_Z, const SCALAR scalar = SCALAR_DOUBLE,
+			const STORAGE storage = STORAGE_ROWS );
 
 	public:
 		void ClearBuffers( void );
 
 		sstr GetTitleBar( void ) { return &m_szTitle; };
 
+		/* a copy of the title, safe from the thread of the window */
+		string GetTitle( void );
+
+		/* the frame or stage times of the last LATENCY_WINDOW seconds, and the *
+		 * same printed as p50/p95/p99/max, from the thread of the solver       */
+		LatencyHistogram GetLatency( const LATENCYSTAGE stage ) { return m_latency[stage].Window(); };
+
+		void PrintLatency( void );
+
+		const GridLayout &GetGrid( void ) const { return m_grid; };
+
+		SCALAR GetScalar( void ) const { return m_scalar; };
+
+		/* threads < 1 uses every hardware core */
+		void SetThreads( cint threads ) { m_pool.Resize( threads ); };
+
+		int GetThreads( void ) const { return m_pool.Threads(); };
+
+		void SetRelaxation( const RELAXATION mode ) { m_relax = mode; };
+
+		RELAXATION GetRelaxation( void ) const { return m_relax; };
+
+		/* anything wider than DetectSimd() falls back to what the CPU offers, *
+		 * bricked and sparse fields have no rows for the vectors, stay scalar */
+		void SetSimd( const SIMD simd )
+		{
+			m_simd = ( simd <= DetectSimd() ) ? simd : DetectSimd();
+			if ( m_grid.storage not_eq STORAGE_ROWS ) m_simd = SIMD_SCALAR;
+		};
+
+		SIMD GetSimd( void ) const { return m_simd; };
+
+		/* depth > 0 runs that many sweeps of the relaxation in a single pass over the *
+		 * grid, with the same result; 0 turns the temporal blocking off               */
+		void SetTemporalBlocking( cint depth ) { m_depth = ( depth > 0 ) ? depth : 0; };
+
+		int GetTemporalBlocking( void ) const { return m_depth; };
+
+		/* tol is the residual of the pressure equation relative to the divergence, *
+		 * both are ignored by PRESSURE_JACOBI, the only solver of sparse fields     */
+		void SetPressureSolver( const PRESSURESOLVER mode, cdouble tol = 1e-4, cint maxcycles = 20 )
+		{
+			m_pressure = mode; m_tolerance = tol; m_maxcycles = maxcycles;
+			if ( m_grid.storage eqt STORAGE_SPARSE ) m_pressure = PRESSURE_JACOBI;
+		};
+
+		PRESSURESOLVER GetPressureSolver( void ) const { return m_pressure; };
+
+		int GetPressureCycles( void ) const { return m_cycles; };
+
+		/* negative if none was measured, PRESSURE_JACOBI only measures it when asked, *
+		 * a pass over the grid that its sweeps do not need; the multigrid solvers     *
+		 * have it anyway                                                              */
+		double GetPressureResidual( void ) const { return m_residual; };
+
+		void SetJacobiResidual( const bool on ) { m_jacobiresidual = on; };
+
+		bool GetJacobiResidual( void ) const { return m_jacobiresidual; };
+
+		/* the projections are part of VelocitySolver, timed apart for the benchmarks */
+		double GetProjectionTime( void ) const { return m_projtime; };
+
+		int GetSteps( void ) const { return m_steps; };
+
+		/* the density of the interior reduced by op, bit for bit the same for any *
+		 * number of threads, so runs can be told apart by their results           */
+		double ReduceDensity( const REDUCTION op );
+
+		/* the fields of the grid, the step count and the settings of the solver *
+		 * written to a snapshot file, or restored from one written by a solver  *
+		 * of the same grid, storage and precision, both through a mapping of    *
+		 * the file; false, with a message, if that fails. the subnodes are only *
+		 * saved if they keep their state, NODES_EXCHANGE, and restored if the   *
+		 * solver has the same, otherwise they are upsampled again from the grid */
+		bool SaveCurStage( const char *path = SNAPSHOT_FILE );
+
+		bool LoadPreStage( const char *path = SNAPSHOT_FILE );
+
+		/* SaveCurStage or LoadPreStage of SNAPSHOT_FILE from a thread other than *
+		 * the solver's, the window's keys: both run the pool and replace fields  *
+		 * the step in progress works on, so the solver does it before its next  */
+		void RequestSave( void ) { m_savereq.store( true ); };
+
+		void RequestLoad( void ) { m_loadreq.store( true ); };
+
+		/* the same as SaveCurStage, but on Linux the solver only stops to fork the *
+		 * process, and the child writes the snapshot from its copy-on-write view   *
+		 * of the fields, while the solver steps on; the file is renamed into path  *
+		 * when complete, so the previous one survives a crash. one at a time, false *
+		 * if the last is still being written or the fork failed                     */
+		bool ForkCurStage( const char *path = SNAPSHOT_FILE );
+
+		/* reap the child of ForkCurStage once done, or wait for it if block, and *
+		 * report how it went; false if it is still writing                       */
+		bool WaitCheckpoint( const bool block );
+
+		/* seconds the solver stood still for the last checkpoint */
+		double GetCheckpointStall( void ) const { return m_stall; };
+
+		/* let FluidSimSolver fork a checkpoint to path every so many seconds, 0 stops */
+		void SetCheckpoints( const char *path, cdouble seconds );
+
+		/* write the density of the grid, and its velocity if asked, after every *
+		 * step to the raw file at path, on a thread of its own through depth    *
+		 * buffers, which policy says what to do about when all are queued; the  *
+		 * subnodes are not written, only the grid                               */
+		bool StartExport( const char *path, const bool velocity = false, cint depth = EXPORT_DEPTH,
+			const EXPORTPOLICY policy = EXPORT_BLOCK );
+
+		/* the frames still queued written, and the index */
+		void StopExport( void ) { m_exporter.Close(); };
+
+		const FrameExporter &GetExporter( void ) const { return m_exporter; };
+
+		/* count cycles, instructions, LLC and dTLB misses of the stages of the grid, *
+		 * Linux only; false, with a message, if the kernel offers none of them       */
+		bool EnableCounters( const bool on );
+
+		const PerfCounters &GetCounters( void ) const { return m_perf; };
+
+		/* the counts of stage since the last reset, a step of a benchmark resets them */
+		const PERFSAMPLE &GetStageCounters( const PERFSTAGE stage ) const { return m_perfstage[stage]; };
+
+		void ResetCounters( void ) { for ( int i = 0; i < PERF_STAGES; i++ ) m_perfstage[i].Clear(); };
+
 //		sstr GetTitleBar( void );
 
 		void FreeResource( void );
@@ -48,35 +308,190 @@ namespace sge
 
 		void InitParams( FLUIDSPARAM *fluid );
 
-		void RefreshStatus( FLUIDSPARAM *fluid );
+		/* true once a second, when the FPS and the title were refreshed */
+		bool RefreshStatus( FLUIDSPARAM *fluid );
 
 		void FluidSimSolver( FLUIDSPARAM *fluid );
 
 		void InitBoundary( void );
 
-	private:
-		inline int ix(cint i, cint j, cint k ) { return k * 128 * 128 + j * 128 + i; };
+	public:
+		/* the two-level scheme of Speedup_x128: the grid of the solver is the coarse *
+		 * global grid, upsampled twice along each axis into NODES_X * NODES_Y *      *
+		 * NODES_Z subnodes, and those whose density sums to more than gate are      *
+		 * solved again at the fine resolution; a negative gate solves all of them.  *
+		 * the volume handed to the renderer becomes the fine one                    */
+		void EnableSubnodes( FLUIDSPARAM *fluid, cdouble gate = NODES_GATE,
+			const NODESYNC sync = NODES_INTERPOLATE );
+
+		NODESYNC GetNodeSync( void ) const { return m_sync; };
+
+		/* on, the next SolveGlobalFlux starts from the refined results, the global *
+		 * cells under the solved subnodes taking the mean of the fine cells        */
+		void SetNodeRestriction( const bool on ) { m_restrict = on; };
+
+		bool GetNodeRestriction( void ) const { return m_restrict; };
+
+		bool HasSubnodes( void ) const { return m_nodesum.size() > 0; };
+
+		int GetSubnodes( void ) const { return (int)m_nodesum.size(); };
+
+		int GetSolvedNodes( void ) const { return m_solved; };
+
+		double GetNodeSolveTime( void ) const { return m_nodetime; };
+
+		/* one step of the global grid, source included */
+		void SolveGlobalFlux( void );
+
+		/* the density of the global grid upsampled into every subnode, and summed *
+		 * for the gate, the velocity only into the subnodes above it               */
+		void InterpolationData( void );
+
+		/* the subnodes above the gate solved on the pool, after InterpolationData, or *
+		 * for NODES_EXCHANGE after SyncNodes, and followed by ExchangeHalos and by    *
+		 * RestrictNodes if asked to                                                   */
+		void SolveNodeFlux( void );
+
+	public:
+		/* single stages of one simulation step, also driven by the headless benchmark */
+		void SourceSolver( cdouble dt );
+
+		void VelocitySolver( cdouble dt );
+
+		void DensitySolver( cdouble dt );
 
 		void GenerVolumeImg( void );
 
+		/* the current frame queued to the exporter, if any, after GenerVolumeImg */
+		void ExportFrame( void );
+
 	private:
 		void SolveNavierStokesEquation
 			( cdouble dt, bool add, bool vel, bool dens );
 
-		void DensitySolver( cdouble dt );
+		template <typename T>
+		bool AllocateFields( const GridLayout &grid, FIELDS<T> &f );
 
-		void VelocitySolver( cdouble dt );
+		template <typename T>
+		bool AllocateNodes( vector< FIELDS<T> > &nodes );
 
-		void SourceSolver( cdouble dt );
+		template <typename T>
+		void FreeFields( FIELDS<T> &f );
+
+		template <class L, typename T>
+		void ClearFields( const L &lay, FIELDS<T> &f );
+
+		template <class L, typename T>
+		void InitBoundary( const L &lay, FIELDS<T> &f );
+
+		bool IsSource( cint i, cint j, cint k ) const;
+
+		/* pool NULL copies on the calling thread alone, as the child of a fork must */
+		bool SaveStage( const char *path, ThreadPool *pool );
+
+		template <typename T>
+		bool SaveCurStage( FIELDS<T> &f, vector< FIELDS<T> > &nodes, const char *path, ThreadPool *pool );
+
+		template <typename T>
+		bool LoadPreStage( FIELDS<T> &f, vector< FIELDS<T> > &nodes, const char *path );
+
+		/* follow the smoke with the active bricks of a sparse grid */
+		void UpdateBricks( void );
+
+		template <typename T>
+		void UpdateBricks( FIELDS<T> &f );
+
+		template <class L, typename T>
+		void GenerVolumeImg( const L &lay, FIELDS<T> &f );
+
+		template <typename T>
+		void GenerNodeVolume( vector< FIELDS<T> > &nodes );
+
+		template <class L, typename T>
+		void ExportFrame( const L &lay, FIELDS<T> &f, float *out );
+
+		template <typename T>
+		void InterpolationData( FIELDS<T> &global, vector< FIELDS<T> > &nodes );
+
+		template <typename T>
+		void SolveNodeFlux( vector< FIELDS<T> > &nodes );
+
+		/* NODES_EXCHANGE: the gate of every subnode, from its own density once active *
+		 * and from the global grid before, the newly active ones upsampled from it    */
+		void SyncNodes( void );
 
-		void Jacobi( double *out, cdouble *in, cdouble diff, cdouble divisor );
+		template <typename T>
+		void SyncNodes( FIELDS<T> &global, vector< FIELDS<T> > &nodes );
 
-		void Advection( double *out, cdouble *in, cdouble *u, cdouble *v, cdouble *w, cdouble dt );
+		/* NODES_EXCHANGE: the six face halos of the active subnodes copied from the *
+		 * active neighbours, the others keep the halo they were upsampled with      */
+		void ExchangeHalos( void );
 
-		void Diffusion( double *out, cdouble *in, cdouble diff );
+		template <typename T>
+		void ExchangeHalos( vector< FIELDS<T> > &nodes );
 
-		void Projection( double *u, double *v, double *w, double *div, double *p );
+		/* the solved subnodes averaged into the global cells under their interiors */
+		void RestrictNodes( void );
+
+		template <typename T>
+		void RestrictNodes( FIELDS<T> &global, vector< FIELDS<T> > &nodes );
+
+		/* the sources of the global grid marked on the fine cells above them */
+		template <typename T>
+		void InitNodeBoundary( vector< FIELDS<T> > &nodes );
+
+		/* fine cell offset of the first interior cell of subnode n */
+		void NodeOrigin( cint n, int &oi, int &oj, int &ok ) const
+		{
+			oi = n % NODES_X * ( m_node.nx - 2 );
+			oj = n / NODES_X % NODES_Y * ( m_node.ny - 2 );
+			ok = n / NODES_X / NODES_Y * ( m_node.nz - 2 );
+		};
+
+		/* the subnodes solved by SolveNodeFlux, a negative gate takes them all */
+		bool IsGated( cint node ) const { return m_gate < 0.f or m_nodesum[node] > m_gate; };
+
+		template <class L, typename T>
+		void SourceSolver( const L &lay, FIELDS<T> &f, cdouble dt );
+
+		/* the stages below run on the global grid, or on a subnode with a pool of its own */
+		template <typename T>
+		void VelocitySolver( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f, cdouble dt );
+
+		template <typename T>
+		void DensitySolver( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f, cdouble dt );
+
+		template <typename T>
+		void Jacobi( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f,
+			T *out, const T *in, cdouble diff, cdouble divisor );
+
+		template <typename T>
+		void Advection( const GridLayout &grid, T *out, const T *in, const T *u, const T *v, const T *w, cdouble dt );
+
+		template <typename T>
+		void VectorAdvection( const GridLayout &grid,
+			T *outu, T *outv, T *outw, const T *u, const T *v, const T *w, cdouble dt );
+
+		template <typename T>
+		void Diffusion( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f,
+			T *out, const T *in, cdouble diff );
+
+		template <typename T>
+		void Projection( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f,
+			T *u, T *v, T *w, T *div, T *p );
 	};
 };
 
+
+/* expand call with "fields" bound to the fields of the precision in use, *
+ * for the member functions of FluidSimProc                               */
+#define DISPATCH_FIELDS( call ) \
+	if ( m_scalar eqt sge::SCALAR_FLOAT ) { sge::FIELDS<float> &fields = m_ffields; call; } \
+	else                                  { sge::FIELDS<double> &fields = m_dfields; call; }
+
+/* the same with "nodes" bound to the subnodes of the two-level scheme */
+#define DISPATCH_NODES( call ) \
+	if ( m_scalar eqt sge::SCALAR_FLOAT ) { std::vector< sge::FIELDS<float> > &nodes = m_fnodes; call; } \
+	else                                  { std::vector< sge::FIELDS<double> > &nodes = m_dnodes; call; }
+
 #endif
\ No newline at end of file
@@ -17,6 +17,7 @@
 #include <iostream>
 #include "FrameworkDynamic.h"
 #include "FluidSimProc.h"
+#include "Trace.h"
 
 using namespace sge;
 using namespace glm;
@@ -444,6 +445,9 @@ Framework_v1_0::Framework_v1_0( SGMAINACTIVITY **activity, SGUINT width, SGUINT
 	m_activity = new SGMAINACTIVITY( width, height, false );
 	m_simproc  = new FluidSimProc( &m_fluid );
 	*activity = m_activity;
+
+	/* a timeline of the last steps and frames, written on T or on exit */
+	Tracer::Enable( true );
 	cout << "initial stage finished" << endl;
 };
 
@@ -497,6 +501,8 @@ string Framework_v1_0::string_fmt( const std::string fmt_str, ... )
 /* ̣߳ģ */
 DWORD WINAPI Framework_v1_0::FluidSimulationProc( LPVOID lpParam )
 {
+	Tracer::NameThread( "simulation" );
+
 	/* ֻҪm_fluid.runΪ棬һֱģ */
 	while ( m_fluid.run ) m_simproc->FluidSimSolver( &m_fluid );
 
@@ -508,6 +514,8 @@ DWORD WINAPI Framework_v1_0::FluidSimulationProc( LPVOID lpParam )
 /* SGGUIкȵĵһ */
 void Framework_v1_0::onCreate()
 {
+	Tracer::NameThread( "render" );
+
 	/* initialize glew */
 	GLenum error = glewInit ();
 	if ( error != GLEW_OK )
@@ -549,11 +557,15 @@ void Framework_v1_0::CountFPS()
 	/* finally, print the message on the tile bar */
 //	SetWindowText( m_activity->GetHWND(), string_fmt( *m_simproc->GetTitleBar(), m_fluid.fps.uFPS ).c_str() );
 
-	SetWindowText( m_activity->GetHWND(), string_fmt( *m_simproc->GetTitleBar() ).c_str() );
+	/* refreshed by the solver once a second, the tail of the frame times with the FPS */
+	SetWindowText( m_activity->GetHWND(), m_simproc->GetTitle().c_str() );
 }
 
 void Framework_v1_0::onDisplay()
 {
+	/* SGGUI swaps the buffers after this returns, in the gap before the next display */
+	TraceScope display( "display" );
+
 	/* do something before rendering */
 	glEnable ( GL_DEPTH_TEST );
 	
@@ -576,7 +588,12 @@ void Framework_v1_0::onDisplay()
 	m_fluid.shader.ptrShader->LinkShaders 
 		( m_fluid.shader.hProgram, 2, m_fluid.shader.hRCVert, m_fluid.shader.hRCFrag );
 	m_fluid.shader.ptrShader->ActiveProgram ( m_fluid.shader.hProgram );
-	SetVolumeInfoUinforms ( &m_fluid );
+	{
+		/* the volume of the last step done, the same step twice is a frame the *
+		 * renderer drew without a new volume, a step skipped one never shown    */
+		TraceScope upload( "upload", m_simproc->GetSteps() - 1 );
+		SetVolumeInfoUinforms ( &m_fluid );
+	}
 	RenderingFace ( GL_BACK, &m_fluid );
 	m_fluid.shader.ptrShader->DeactiveProgram ( m_fluid.shader.hProgram );
 
@@ -589,6 +606,7 @@ void Framework_v1_0::onDestroy()
 	m_fluid.run = false;
 	WaitForSingleObject( m_fluid.thread.hThread, INFINITE );
 	CloseHandle( m_fluid.thread.hThread );
+	Tracer::Dump();
 
 	/* ͷԴ */
 	m_simproc->FreeResource();
@@ -617,13 +635,27 @@ void Framework_v1_0::onKeyboard( SGKEYS keys, SGKEYSTATUS status )
 			m_simproc->ClearBuffers();
 			break;
 
+		/* the solver thread saves or loads between two of its steps */
+		case SG_KEY_S:
+			m_simproc->RequestSave();
+			break;
+
+		case SG_KEY_L:
+			m_simproc->RequestLoad();
+			break;
+
+		case SG_KEY_T:
+			Tracer::Dump();
+			break;
+
 		case SG_KEY_P:
 			system("cls");
 			cout << "Use mouse to control rotation of observation" << endl 
 				<< "Use Key Q or ESC to quit system" << endl 
                 << "Use Key C to clear stage" << endl
 				<< "Use Key S to save current stage" << endl
-				<< "Use Key L to load previous stage" << endl;
+				<< "Use Key L to load previous stage" << endl
+				<< "Use Key T to write the timeline to " TRACE_FILE << endl;
 			break;
 
 		default:
@@ -0,0 +1,203 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     GridLayout.h
+*/
+
+#ifndef __grid_layout_h_
+#define __grid_layout_h_
+
+#include <stddef.h>
+#include <vector>
+#include <memory>
+#include "MacroDefinition.h"
+#include "BrickMap.h"
+#include "ISO646.h"
+
+namespace sge
+{
+	/* order the cells of a field are stored in */
+	enum STORAGE
+	{
+		STORAGE_ROWS   = 0, // row after row, slab after slab, the reference
+		STORAGE_BRICKS = 1, // brick after brick, see BrickLayout
+		STORAGE_SPARSE = 2, // the active bricks only, see BrickMap and SparseLayout
+	};
+
+
+	/* extent and strides of a field whose size is chosen at runtime, *
+	 * the outermost shell of cells is the boundary of the domain,    *
+	 * around which the storage may keep halo shells of ghost cells   *
+	 * that stay zero, so that samplers can read them unchecked       */
+	struct GridLayout
+	{
+		int nx, ny, nz;  // cells of each axis, boundary included
+		int sx, sxy;     // distance between two rows, and two slabs
+		int halo;        // ghost shells on each side
+		int base;        // index of cell (0, 0, 0)
+		STORAGE storage; // strides and ix() hold for STORAGE_ROWS only
+
+		/* per axis offsets of STORAGE_BRICKS, ghosts included, x then y then z */
+		std::vector<int> bricks;
+
+		/* bricks of STORAGE_SPARSE, shared by the copies of the layout */
+		std::shared_ptr<BrickMap> map;
+
+		GridLayout( cint x = GRIDS_X, cint y = GRIDS_Y, cint z = GRIDS_Z, cint h = 0,
+			const STORAGE order = STORAGE_ROWS )
+			: nx(x), ny(y), nz(z), sx(x + 2 * h), sxy((x + 2 * h) * (y + 2 * h)), halo(h),
+			base(h * ( 1 + (x + 2 * h) + (x + 2 * h) * (y + 2 * h) )), storage(order)
+		{
+			if ( storage eqt STORAGE_BRICKS ) BrickOffsets();
+			if ( storage eqt STORAGE_SPARSE ) map = std::make_shared<BrickMap>( x, y, z, h, SPARSE_SLOTS );
+		};
+
+		inline int X( void ) const { return nx; };
+		inline int Y( void ) const { return ny; };
+		inline int Z( void ) const { return nz; };
+
+		inline int SX( void ) const { return sx; };
+		inline int SXY( void ) const { return sxy; };
+
+		inline int ix( cint i, cint j, cint k ) const { return base + k * sxy + j * sx + i; };
+
+		/* cells of the domain, and elements to allocate for a field, ghosts included */
+		inline size_t Cells( void ) const { return (size_t)nx * ny * nz; };
+		inline size_t Elements( void ) const
+		{
+			if ( storage eqt STORAGE_SPARSE ) return map->Elements();
+			if ( storage eqt STORAGE_BRICKS )
+				return ( (size_t)Bricks( nx + 2 * halo ) * Bricks( ny + 2 * halo ) * Bricks( nz + 2 * halo ) ) << ( 3 * BRICK_SHIFT );
+
+			return (size_t)sxy * ( nz + 2 * halo );
+		};
+
+		/* offset of cell n of an axis, whose bricks lie stride bricks apart, for *
+		 * a cell addressed as brick * BRICK_EDGE^3 + ( z * EDGE + y ) * EDGE + x  */
+		static inline int BrickOffset( cint n, cint stride, cint shift )
+		{
+			return ( ( ( n >> BRICK_SHIFT ) * stride ) << ( 3 * BRICK_SHIFT ) ) + ( ( n & BRICK_MASK ) << shift );
+		};
+
+		void BrickOffsets( void )
+		{
+			cint bx = Bricks( nx + 2 * halo ), bxy = bx * Bricks( ny + 2 * halo );
+
+			bricks.clear();
+			for ( int n = 0; n < nx + 2 * halo; n++ ) bricks.push_back( BrickOffset( n, 1, 0 ) );
+			for ( int n = 0; n < ny + 2 * halo; n++ ) bricks.push_back( BrickOffset( n, bx, BRICK_SHIFT ) );
+			for ( int n = 0; n < nz + 2 * halo; n++ ) bricks.push_back( BrickOffset( n, bxy, 2 * BRICK_SHIFT ) );
+		};
+
+		/* true if a FixedLayout<x, y, h> describes the same memory */
+		inline bool Is( cint x, cint y, cint h ) const
+		{
+			return storage eqt STORAGE_ROWS and nx eqt x and ny eqt y and halo eqt h and
+				sx eqt x + 2 * h and sxy eqt ( x + 2 * h ) * ( y + 2 * h );
+		};
+	};
+
+
+	/* same as GridLayout, but the extent, halo and strides are known at compile *
+	 * time, so neighbour offsets of the stencils fold into immediates           */
+	template <int NX, int NY, int H>
+	struct FixedLayout
+	{
+		enum { SX_ = NX + 2 * H, SXY_ = ( NX + 2 * H ) * ( NY + 2 * H ) };
+
+		int nz;
+
+		explicit FixedLayout( const GridLayout &grid ) : nz(grid.nz) {};
+
+		inline int X( void ) const { return NX; };
+		inline int Y( void ) const { return NY; };
+		inline int Z( void ) const { return nz; };
+
+		inline int SX( void ) const { return SX_; };
+		inline int SXY( void ) const { return SXY_; };
+
+		inline int ix( cint i, cint j, cint k ) const { return ( k + H ) * SXY_ + ( j + H ) * SX_ + i + H; };
+
+		inline size_t Cells( void ) const { return (size_t)NX * NY * nz; };
+		inline size_t Elements( void ) const { return (size_t)SXY_ * ( nz + 2 * H ); };
+	};
+
+
+	/* the cells of a GridLayout, ghosts included, grouped in bricks stored one after *
+	 * the other, each brick in the order of the rows; the six neighbours and eight   *
+	 * trilinear corners of a cell mostly lie in its own brick, a few cache lines and *
+	 * one page, where rows put them a row and a slab apart, so the backtraces of     *
+	 * large grids miss the caches and the TLB less. the stencils work on it through  *
+	 * ix() alone, it has no row strides for the vector rows of Simd.h                */
+	struct BrickLayout
+	{
+		int nx, ny, nz;
+		size_t elements;
+		const int *ox, *oy, *oz; // offsets of the columns, rows and slabs, see BrickOffsets
+
+		explicit BrickLayout( const GridLayout &grid )
+			: nx(grid.nx), ny(grid.ny), nz(grid.nz), elements(grid.Elements()),
+			ox(&grid.bricks[0] + grid.halo),
+			oy(&grid.bricks[0] + grid.nx + 3 * grid.halo),
+			oz(&grid.bricks[0] + grid.nx + grid.ny + 5 * grid.halo) {};
+
+		inline int X( void ) const { return nx; };
+		inline int Y( void ) const { return ny; };
+		inline int Z( void ) const { return nz; };
+
+		/* the brick and the cell within are sums of a term per axis */
+		inline int ix( cint i, cint j, cint k ) const { return ox[i] + oy[j] + oz[k]; };
+
+		inline size_t Cells( void ) const { return (size_t)nx * ny * nz; };
+		inline size_t Elements( void ) const { return elements; };
+	};
+
+
+	/* the cells of a GridLayout of STORAGE_SPARSE, bricked like BrickLayout, but the *
+	 * bricks go through the slot table of the BrickMap, which sends the inactive     *
+	 * ones to the zero brick; reading any cell is fine, writing only to the cells    *
+	 * of the active bricks, so the kernels visit those alone, see kernelBricks       */
+	struct SparseLayout
+	{
+		int nx, ny, nz;
+		const BrickMap *map;
+		const int *bx, *by, *bz; // bricks of the columns, rows and slabs
+		const int *cx, *cy, *cz; // offsets within the brick
+		const int *slot;
+
+		explicit SparseLayout( const GridLayout &grid )
+			: nx(grid.nx), ny(grid.ny), nz(grid.nz), map(grid.map.get()),
+			bx(map->BrickTerms( 0 )), by(map->BrickTerms( 1 )), bz(map->BrickTerms( 2 )),
+			cx(map->CellTerms( 0 )), cy(map->CellTerms( 1 )), cz(map->CellTerms( 2 )),
+			slot(map->SlotTable()) {};
+
+		inline int X( void ) const { return nx; };
+		inline int Y( void ) const { return ny; };
+		inline int Z( void ) const { return nz; };
+
+		inline int ix( cint i, cint j, cint k ) const
+		{
+			return ( slot[ bx[i] + by[j] + bz[k] ] << ( 3 * BRICK_SHIFT ) ) + cx[i] + cy[j] + cz[k];
+		};
+
+		inline size_t Cells( void ) const { return (size_t)nx * ny * nz; };
+		inline size_t Elements( void ) const { return map->Elements(); };
+	};
+};
+
+
+/* expand call with "lay" bound to the fastest layout describing grid, the common *
+ * 64, 128 and 256 cross sections of the padded fields of the solver get their    *
+ * own instantiation, any depth allowed; bricked grids take BrickLayout, sparse   *
+ * ones SparseLayout                                                               */
+#define DISPATCH_LAYOUT( grid, call ) \
+	if ( (grid).storage eqt sge::STORAGE_SPARSE ) { sge::SparseLayout lay( grid ); call; } \
+	else if ( (grid).storage eqt sge::STORAGE_BRICKS ) { sge::BrickLayout lay( grid ); call; } \
+	else if ( (grid).Is( 64, 64, GRIDS_HALO ) )   { sge::FixedLayout<64, 64, GRIDS_HALO>   lay( grid ); call; } \
+	else if ( (grid).Is( 128, 128, GRIDS_HALO ) ) { sge::FixedLayout<128, 128, GRIDS_HALO> lay( grid ); call; } \
+	else if ( (grid).Is( 256, 256, GRIDS_HALO ) ) { sge::FixedLayout<256, 256, GRIDS_HALO> lay( grid ); call; } \
+	else                                          { const sge::GridLayout &lay = grid; call; }
+
+#endif
@@ -0,0 +1,55 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Headless.h
+*/
+
+#ifndef __headless_h_
+#define __headless_h_
+
+#include <stdlib.h>
+#include "MacroDefinition.h"
+
+/* the headless build has neither GLEW/freeglut nor SGE, so the few types *
+ * FluidSimProc borrows from them are re-declared here                    */
+
+typedef unsigned char SGUCHAR;
+typedef bool          SGBOOLEAN;
+typedef unsigned long DWORD;
+typedef unsigned int  UINT;
+
+#ifndef SAFE_FREE_PTR
+#define SAFE_FREE_PTR(ptr) { if ( ptr ) { free( ptr ); ptr = NULL; } }
+#endif
+
+namespace sge
+{
+	/* the part of FLUIDSPARAM which the solver touches, without the *
+	 * shader, texture and thread handles of the rendering framework  */
+	typedef struct FLUIDSPARAM
+	{
+		struct VOLUME
+		{
+			SGUCHAR *ptrData;
+			size_t   uWidth, uHeight, uDepth;
+		};
+
+		struct FPS
+		{
+			DWORD dwFrames;
+			DWORD dwCurrentTime;
+			DWORD dwLastUpdateTime;
+			DWORD dwElapsedTime;
+			UINT  uFPS;
+		};
+
+		VOLUME    volume;
+		FPS       fps;
+		SGBOOLEAN run;
+
+	} SGFLUIDVARS;
+};
+
+#endif
@@ -0,0 +1,159 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Histogram.cpp
+*/
+
+#include <math.h>
+#include "Histogram.h"
+
+using namespace sge;
+
+/* the exact buckets, and LATENCY_SUBBUCKETS for every power of two above */
+static const int t_buckets = LATENCY_SUBBUCKETS * ( LATENCY_RANGE - LATENCY_SHIFT + 1 );
+
+
+LatencyHistogram::LatencyHistogram( void )
+	: m_counts( t_buckets, 0 ), m_total(0), m_max(0.f), m_sum(0.f)
+{
+};
+
+
+int LatencyHistogram::Bucket( const unsigned long long micros )
+{
+	if ( micros < 2 * LATENCY_SUBBUCKETS ) return (int)micros;
+
+	/* the top bits of micros, LATENCY_SUBBUCKETS to twice that, and the power of *
+	 * two they were shifted by, bucket LATENCY_SUBBUCKETS * shift onward          */
+	int msb = 0;
+	while ( ( micros >> ( msb + 1 ) ) > 0 ) msb++;
+
+	int shift = msb - LATENCY_SHIFT;
+	int bucket = LATENCY_SUBBUCKETS * shift + (int)( micros >> shift );
+
+	return ( bucket < t_buckets ) ? bucket : t_buckets - 1;
+};
+
+
+unsigned long long LatencyHistogram::Upper( cint bucket )
+{
+	if ( bucket < 2 * LATENCY_SUBBUCKETS ) return (unsigned long long)bucket;
+
+	int shift = bucket / LATENCY_SUBBUCKETS - 1;
+	unsigned long long sub = (unsigned long long)( bucket - LATENCY_SUBBUCKETS * shift );
+
+	return ( ( sub + 1 ) << shift ) - 1;
+};
+
+
+void LatencyHistogram::Record( cdouble seconds )
+{
+	double micros = ( seconds > 0.f ) ? seconds * 1e6 : 0.f;
+
+	m_counts[ Bucket( (unsigned long long)( micros + 0.5 ) ) ]++;
+	m_total++;
+	m_sum += seconds;
+	if ( seconds > m_max ) m_max = seconds;
+};
+
+
+void LatencyHistogram::Add( const LatencyHistogram &other )
+{
+	for ( int i = 0; i < t_buckets; i++ ) m_counts[i] += other.m_counts[i];
+
+	m_total += other.m_total;
+	m_sum   += other.m_sum;
+	if ( other.m_max > m_max ) m_max = other.m_max;
+};
+
+
+void LatencyHistogram::Clear( void )
+{
+	for ( int i = 0; i < t_buckets; i++ ) m_counts[i] = 0;
+
+	m_total = 0;
+	m_max = m_sum = 0.f;
+};
+
+
+double LatencyHistogram::Percentile( cdouble p ) const
+{
+	if ( m_total eqt 0 ) return 0.f;
+
+	unsigned long long rank = (unsigned long long)ceil( p / 100.0 * m_total );
+	if ( rank < 1 ) rank = 1;
+	if ( rank >= m_total ) return m_max;
+
+	unsigned long long seen = 0;
+	for ( int i = 0; i < t_buckets; i++ )
+	{
+		seen += m_counts[i];
+		if ( seen >= rank )
+		{
+			/* the bucket may reach past the largest duration recorded */
+			double upper = Upper( i ) * 1e-6;
+			return ( upper < m_max ) ? upper : m_max;
+		}
+	}
+
+	return m_max;
+};
+
+
+const char *LatencyHistogram::StageName( cint stage )
+{
+	static const char *names[LATENCY_STAGES] = { "frame", "source", "velocity", "density", "nodes", "volume" };
+	return ( stage >= 0 and stage < LATENCY_STAGES ) ? names[stage] : "";
+};
+
+
+void SlidingHistogram::Slide( cdouble now )
+{
+	const double slice = (double)LATENCY_WINDOW / LATENCY_SLICES;
+
+	if ( m_start <= 0.f ) m_start = now;
+
+	/* idle for longer than the window, every slice is stale */
+	if ( now - m_start >= LATENCY_WINDOW + slice )
+	{
+		Clear();
+		m_start = now;
+		return;
+	}
+
+	while ( now - m_start >= slice )
+	{
+		m_current = ( m_current + 1 ) % LATENCY_SLICES;
+		m_slices[m_current].Clear();
+		m_start += slice;
+	}
+};
+
+
+void SlidingHistogram::Record( cdouble seconds, cdouble now )
+{
+	Slide( now );
+	m_slices[m_current].Record( seconds );
+};
+
+
+LatencyHistogram SlidingHistogram::Window( cdouble now )
+{
+	Slide( now );
+
+	LatencyHistogram window;
+	for ( int i = 0; i < LATENCY_SLICES; i++ ) window.Add( m_slices[i] );
+
+	return window;
+};
+
+
+void SlidingHistogram::Clear( void )
+{
+	for ( int i = 0; i < LATENCY_SLICES; i++ ) m_slices[i].Clear();
+
+	m_current = 0;
+	m_start   = 0.f;
+};
@@ -0,0 +1,130 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Histogram.h
+*/
+
+#ifndef __histogram_h_
+#define __histogram_h_
+
+#include <vector>
+#include "StopWatch.h"
+#include "ISO646.h"
+
+/* buckets per power of two, above 2 * LATENCY_SUBBUCKETS microseconds, *
+ * so a percentile is off by less than 1 / LATENCY_SUBBUCKETS           */
+#define LATENCY_SHIFT      6
+#define LATENCY_SUBBUCKETS ( 1 << LATENCY_SHIFT )
+
+/* powers of two of microseconds recorded, up to about 12 days */
+#define LATENCY_RANGE      40
+
+/* seconds the sliding percentiles look back, in slices of a second */
+#define LATENCY_WINDOW     5
+#define LATENCY_SLICES     5
+
+namespace sge
+{
+	/* the times of a frame kept in the sliding windows of the solver */
+	enum LATENCYSTAGE
+	{
+		LATENCY_FRAME    = 0, // from one RefreshStatus to the next, the frame time
+		LATENCY_SOURCE   = 1,
+		LATENCY_VELOCITY = 2,
+		LATENCY_DENSITY  = 3,
+		LATENCY_NODES    = 4, // SolveNodeFlux of the two-level scheme
+		LATENCY_VOLUME   = 5, // GenerVolumeImg
+		LATENCY_STAGES   = 6,
+	};
+
+
+	/* a histogram of durations in the manner of HdrHistogram: microseconds are *
+	 * counted exactly up to 2 * LATENCY_SUBBUCKETS, and with the same relative *
+	 * precision above, in a fixed array, so recording never allocates          */
+	class LatencyHistogram
+	{
+	private:
+		std::vector<unsigned int> m_counts;
+		unsigned long long m_total;
+		double m_max, m_sum;
+
+	public:
+		LatencyHistogram( void );
+
+	public:
+		void Record( cdouble seconds );
+
+		void Add( const LatencyHistogram &other );
+
+		void Clear( void );
+
+		unsigned long long Count( void ) const { return m_total; };
+
+		/* seconds p percent of the durations do not exceed, by nearest rank, the *
+		 * upper edge of its bucket; 0 if nothing was recorded                   */
+		double Percentile( cdouble p ) const;
+
+		double Max( void ) const { return m_max; };
+
+		double Mean( void ) const { return ( m_total > 0 ) ? m_sum / m_total : 0.f; };
+
+		static const char *StageName( cint stage );
+
+	private:
+		static int Bucket( const unsigned long long micros );
+
+		/* the largest microseconds that fall into bucket */
+		static unsigned long long Upper( cint bucket );
+	};
+
+
+	/* the durations of the last LATENCY_WINDOW seconds, kept as LATENCY_SLICES *
+	 * histograms of a slice each, the oldest cleared as time moves on           */
+	class SlidingHistogram
+	{
+	private:
+		LatencyHistogram m_slices[LATENCY_SLICES];
+		int m_current;
+		double m_start;
+
+	public:
+		SlidingHistogram( void ) : m_current(0), m_start(0.f) {};
+
+	public:
+		void Record( cdouble seconds, cdouble now = StopWatch::Now() );
+
+		/* the slices merged, from LATENCY_WINDOW - 1 to LATENCY_WINDOW seconds back */
+		LatencyHistogram Window( cdouble now = StopWatch::Now() );
+
+		void Clear( void );
+
+	private:
+		void Slide( cdouble now );
+	};
+
+
+	/* records the duration of its scope */
+	class LatencyScope
+	{
+	private:
+		SlidingHistogram &m_histogram;
+		double m_begin;
+
+	public:
+		explicit LatencyScope( SlidingHistogram &histogram ) : m_histogram( histogram ), m_begin( StopWatch::Now() ) {};
+
+		~LatencyScope( void )
+		{
+			double now = StopWatch::Now();
+			m_histogram.Record( now - m_begin, now );
+		};
+
+	private:
+		LatencyScope( const LatencyScope& );
+		LatencyScope &operator=( const LatencyScope& );
+	};
+};
+
+#endif
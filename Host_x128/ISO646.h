@@ -24,6 +24,8 @@
 * <File>        ISO646.h
 */
 
+/* standard C++ compilers already treat these as operator keywords, only MSVC needs them */
+#if defined(_MSC_VER)
 #define and    &&
 #define and_eq &=
 #define bitand &
@@ -35,9 +37,18 @@
 #define or_eq  |=
 #define xor    ^
 #define xor_eq ^=
+#endif
 #define eqt    ==
 #define elif  else if
 
+/* thread_local arrived with Visual Studio 2015, the older ones only take *
+ * __declspec(thread), enough for the constant initialized variables here */
+#if defined(_MSC_VER) and _MSC_VER < 1900
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL thread_local
+#endif
+
 #include <string>
 
 typedef double const  cdouble;
@@ -0,0 +1,893 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Kernels.h
+*/
+
+#ifndef __kernels_h_
+#define __kernels_h_
+
+#include <string.h>
+#include <math.h>
+#include <utility>
+#include <vector>
+#include "GridLayout.h"
+#include "ThreadPool.h"
+#include "Simd.h"
+#include "ISO646.h"
+
+/* the CPU counterparts of the CUDA kernels, templated on the layout of the *
+ * fields so the fixed size grids get their own, fully unrolled indexing,   *
+ * and on the scalar type T the fields are stored in                        */
+
+namespace sge
+{
+	/* clamps x to [-1, n] and returns the cell of the trilinear stencil around it, *
+	 * the weight of its upper corners is then x - cell; every point outside the    *
+	 * grid samples zero, and so does the ghost shell a clamped point falls on, so  *
+	 * the eight corners are always in the storage and need no checks; needs a     *
+	 * halo of at least one cell                                                    */
+	template <typename T>
+	inline int atomicCell( T &x, cint n )
+	{
+		/* not-a-number goes to the ghost shell too */
+		x = ( x > -1 ) ? x : -1;
+		x = ( x < n ) ? x : n;
+
+		/* floor, x may be negative */
+		int i = (int)x;
+		i -= ( x < i );
+
+		return ( i < n - 1 ) ? i : n - 1;
+	};
+
+
+	/* indices of the corners of cell ( i, j, k ), in the order of atomicLerp */
+	template <class L>
+	inline void atomicCorners( const L &lay, cint i, cint j, cint k, int *c )
+	{
+		c[0] = lay.ix( i, j, k );         c[1] = lay.ix( i + 1, j, k );
+		c[2] = lay.ix( i, j + 1, k );     c[3] = lay.ix( i + 1, j + 1, k );
+		c[4] = lay.ix( i, j, k + 1 );     c[5] = lay.ix( i + 1, j, k + 1 );
+		c[6] = lay.ix( i, j + 1, k + 1 ); c[7] = lay.ix( i + 1, j + 1, k + 1 );
+	};
+
+
+	/* the corners c of a cell of grid, weighted by dx, dy and dz along i, j and k */
+	template <typename T>
+	inline T atomicLerp
+		( const T *grid, const int *c, const T dx, const T dy, const T dz )
+	{
+		T c00 = grid[ c[0] ] * ( 1 - dx ) + grid[ c[1] ] * dx;
+		T c10 = grid[ c[2] ] * ( 1 - dx ) + grid[ c[3] ] * dx;
+		T c01 = grid[ c[4] ] * ( 1 - dx ) + grid[ c[5] ] * dx;
+		T c11 = grid[ c[6] ] * ( 1 - dx ) + grid[ c[7] ] * dx;
+
+		T c0 = c00 * ( 1 - dy ) + c10 * dy;
+		T c1 = c01 * ( 1 - dy ) + c11 * dy;
+
+		return c0 * ( 1 - dz ) + c1 * dz;
+	};
+
+
+	template <class L, typename T>
+	inline T atomicTrilinear
+		( const L &lay, const T *grid, T x, T y, T z )
+	{
+		int i = atomicCell( x, lay.X() );
+		int j = atomicCell( y, lay.Y() );
+		int k = atomicCell( z, lay.Z() );
+
+		int c[8];
+		atomicCorners( lay, i, j, k, c );
+
+		return atomicLerp( grid, c, x - i, y - j, z - k );
+	};
+
+
+	/* atomicTrilinear of the three fields u, v and w at the same point, the cell and *
+	 * the weights are worked out once                                                */
+	template <class L, typename T>
+	inline void atomicTrilinearVector
+		( const L &lay, const T *u, const T *v, const T *w, T x, T y, T z,
+		T &outu, T &outv, T &outw )
+	{
+		int i = atomicCell( x, lay.X() );
+		int j = atomicCell( y, lay.Y() );
+		int k = atomicCell( z, lay.Z() );
+
+		int c[8];
+		atomicCorners( lay, i, j, k, c );
+		const T dx = x - i, dy = y - j, dz = z - k;
+
+		outu = atomicLerp( u, c, dx, dy, dz );
+		outv = atomicLerp( v, c, dx, dy, dz );
+		outw = atomicLerp( w, c, dx, dy, dz );
+	};
+
+
+	template <class L, typename T>
+	void kernelAdvection
+		( const L &lay, T *out, const T *in, const T *u, const T *v, const T *w, cdouble dt )
+	{
+		const T h = (T)dt;
+
+		for ( int k = 1; k < lay.Z() - 1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ ) for ( int i = 1; i < lay.X() - 1; i++ )
+		{
+			T velu = i - u[ lay.ix(i,j,k) ] * h;
+			T velv = j - v[ lay.ix(i,j,k) ] * h;
+			T velw = k - w[ lay.ix(i,j,k) ] * h;
+
+			out[ lay.ix(i,j,k) ] = atomicTrilinear( lay, in, velu, velv, velw );
+		}
+	};
+
+
+	/* kernelAdvection of u, v and w by themselves into outu, outv and outw, the cells *
+	 * are traced back once instead of three times                                    */
+	template <class L, typename T>
+	void kernelVectorAdvection
+		( const L &lay, T *outu, T *outv, T *outw, const T *u, const T *v, const T *w, cdouble dt )
+	{
+		const T h = (T)dt;
+
+		for ( int k = 1; k < lay.Z() - 1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ ) for ( int i = 1; i < lay.X() - 1; i++ )
+		{
+			const size_t id = lay.ix(i,j,k);
+
+			T velu = i - u[id] * h;
+			T velv = j - v[id] * h;
+			T velw = k - w[id] * h;
+
+			atomicTrilinearVector( lay, u, v, w, velu, velv, velw, outu[id], outv[id], outw[id] );
+		}
+	};
+
+
+	/* ordering of the relaxation sweeps of kernelJacobi */
+	enum RELAXATION
+	{
+		RELAX_GAUSS_SEIDEL = 0, // lexicographic and in place on one thread, the reference
+		RELAX_RED_BLACK    = 1, // odd and even cells in turn, in place, multithreaded
+		RELAX_JACOBI       = 2, // true Jacobi, ping-pong with a scratch field, multithreaded
+	};
+
+
+	/* relax every step-th cell of row (j, k) from i0 on, reading the neighbours from src */
+	template <class L, typename T>
+	inline void atomicJacobiRow
+		( const L &lay, T *out, const T *src, const T *in, const T diff, const T dix,
+		cint j, cint k, cint i0, cint step )
+	{
+		for ( int i = i0; i < lay.X() - 1; i += step )
+		{
+			out[lay.ix(i, j, k)] = (
+				in[lay.ix(i, j, k)] + diff * (
+				src[lay.ix(i-1, j, k)] + src[lay.ix(i+1, j, k)] +
+				src[lay.ix(i, j-1, k)] + src[lay.ix(i, j+1, k)] +
+				src[lay.ix(i, j, k-1)] + src[lay.ix(i, j, k+1)] 	)) / dix;
+		}
+	};
+
+
+	/* 10 sweeps of ( in + diff * sum of the six neighbours ) / divisor on out, the       *
+	 * red-black and Jacobi orderings give the same result for any number of threads,    *
+	 * scratch is only used by RELAX_JACOBI and must be as large as out                  */
+	template <class L, typename T>
+	void kernelJacobi
+		( const L &lay, ThreadPool &pool, const RELAXATION mode,
+		T *out, const T *in, T *scratch, cdouble rate, cdouble divisor )
+	{
+		const T diff = (T)rate;
+		const T dix  = ( divisor > 0 ) ? (T)divisor : 1.f;
+
+		if ( mode eqt RELAX_GAUSS_SEIDEL )
+		{
+			for ( int n = 0; n < 10; n++ )
+			{
+				for ( int k = 1; k < lay.Z() - 1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+					atomicJacobiRow( lay, out, out, in, diff, dix, j, k, 1, 1 );
+			}
+		}
+		elif ( mode eqt RELAX_RED_BLACK )
+		{
+			for ( int n = 0; n < 10; n++ ) for ( int color = 0; color < 2; color++ )
+			{
+				pool.ParallelFor( 1, lay.Z() - 1, [&]( int k0, int k1 )
+				{
+					for ( int k = k0; k < k1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+						atomicJacobiRow( lay, out, out, in, diff, dix, j, k, 1 + ( ( 1 + j + k + color ) & 1 ), 2 );
+				} );
+			}
+		}
+		else
+		{
+			/* the boundary cells of scratch have to match those of out */
+			memcpy( scratch, out, lay.Elements() * sizeof(T) );
+
+			T *src = out, *dst = scratch;
+			for ( int n = 0; n < 10; n++ )
+			{
+				pool.ParallelFor( 1, lay.Z() - 1, [&]( int k0, int k1 )
+				{
+					for ( int k = k0; k < k1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+						atomicJacobiRow( lay, dst, src, in, diff, dix, j, k, 1, 1 );
+				} );
+				std::swap( src, dst );
+			}
+
+			if ( src not_eq out ) memcpy( out, src, lay.Elements() * sizeof(T) );
+		}
+	};
+
+
+	template <class L, typename T>
+	void kernelGradient
+		( const L &lay, T *div, T *prs, const T *u, const T *v, const T *w )
+	{
+		for ( int k = 1; k < lay.Z() - 1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ ) for ( int i = 1; i < lay.X() - 1; i++ )
+		{
+			div[ lay.ix(i,j,k) ] = (T) ( -1.f / 3.f * (
+				( u[ lay.ix(i+1,j,k) ] - u[ lay.ix(i-1,j,k) ] ) / (T)lay.X() +
+				( v[ lay.ix(i,j+1,k) ] - v[ lay.ix(i,j-1,k) ] ) / (T)lay.Y() +
+				( w[ lay.ix(i,j,k+1) ] - w[ lay.ix(i,j,k-1) ] ) / (T)lay.Z() ));
+
+			// zero out the present velocity gradient
+			prs[ lay.ix(i,j,k) ] = 0.f;
+		}
+	};
+
+
+	template <class L, typename T>
+	void kernelSubtract
+		( const L &lay, T *u, T *v, T *w, const T *prs )
+	{
+		for ( int k = 1; k < lay.Z() - 1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ ) for ( int i = 1; i < lay.X() - 1; i++ )
+		{
+			u[ lay.ix(i,j,k) ] -= 0.5f * lay.X() * ( prs[ lay.ix(i+1,j,k) ] - prs[ lay.ix(i-1,j,k) ] );
+			v[ lay.ix(i,j,k) ] -= 0.5f * lay.Y() * ( prs[ lay.ix(i,j+1,k) ] - prs[ lay.ix(i,j-1,k) ] );
+			w[ lay.ix(i,j,k) ] -= 0.5f * lay.Z() * ( prs[ lay.ix(i,j,k+1) ] - prs[ lay.ix(i,j,k-1) ] );
+		}
+	};
+
+
+	/* fill count fields of a subnode from the same fields of lay, upsampled twice along *
+	 * each axis: cell ( i, j, k ) of node is the fine cell ( oi + i - 1, oj + j - 1,    *
+	 * ok + k - 1 ), so the outermost shell of the node overlaps its neighbours, and the *
+	 * fine cells beyond the grid are zero, as kernelFillBullet of Speedup_x128 does     */
+	template <class L, typename T>
+	void kernelUpScaling
+		( const L &lay, const GridLayout &node, T *const *out, const T *const *in, cint count,
+		cint oi, cint oj, cint ok, cint i0, cint i1, cint j0, cint j1, cint k0, cint k1 )
+	{
+		for ( int k = k0; k < k1; k++ ) for ( int j = j0; j < j1; j++ ) for ( int i = i0; i < i1; i++ )
+		{
+			cint x = oi + i - 1, y = oj + j - 1, z = ok + k - 1;
+
+			if ( x < 0 or y < 0 or z < 0 or x >= 2 * lay.X() or y >= 2 * lay.Y() or z >= 2 * lay.Z() )
+			{
+				for ( int f = 0; f < count; f++ ) out[f][ node.ix(i,j,k) ] = 0.f;
+				continue;
+			}
+
+			/* fine cell x lies at x / 2 of the grid, so the trilinear stencil is found *
+			 * without atomicCell; the last fine cell of an axis reaches into the ghost *
+			 * shell, which is zero                                                     */
+			int c[8];
+			atomicCorners( lay, x >> 1, y >> 1, z >> 1, c );
+
+			const T dx = ( x & 1 ) * (T)0.5, dy = ( y & 1 ) * (T)0.5, dz = ( z & 1 ) * (T)0.5;
+
+			for ( int f = 0; f < count; f++ )
+				out[f][ node.ix(i,j,k) ] = atomicLerp( in[f], c, dx, dy, dz );
+		}
+	};
+
+
+	/* kernelUpScaling of the cells [i0, i1) x [j0, j1) x [k0, k1) of node alone */
+	template <class L, typename T>
+	void kernelUpScaling
+		( const L &lay, const GridLayout &node, T *const *out, const T *const *in, cint count,
+		cint oi, cint oj, cint ok )
+	{
+		kernelUpScaling( lay, node, out, in, count, oi, oj, ok, 0, node.nx, 0, node.ny, 0, node.nz );
+	};
+
+
+	/* whether cell ( i, j, k ) has storage of its own; for SparseLayout only the *
+	 * cells of the active bricks, the others share the zero brick                */
+	template <class L>
+	inline bool atomicWritable( const L &lay, cint i, cint j, cint k )
+	{
+		return true;
+	};
+
+
+	inline bool atomicWritable( const SparseLayout &lay, cint i, cint j, cint k )
+	{
+		return lay.slot[ lay.bx[i] + lay.by[j] + lay.bz[k] ] not_eq 0;
+	};
+
+
+	/* the inverse of kernelUpScaling: every interior cell of lay under the interior *
+	 * of node, whose first interior cell is the fine cell ( oi, oj, ok ), takes the *
+	 * mean of the eight fine cells it covers, in count fields                       */
+	template <class L, typename T>
+	void kernelDownScaling
+		( const L &lay, const GridLayout &node, T *const *out, const T *const *in, cint count,
+		cint oi, cint oj, cint ok )
+	{
+		cint i0 = ( oi / 2 > 1 ) ? oi / 2 : 1, i1 = ( ( oi + node.nx - 2 ) / 2 < lay.X() - 1 ) ? ( oi + node.nx - 2 ) / 2 : lay.X() - 1;
+		cint j0 = ( oj / 2 > 1 ) ? oj / 2 : 1, j1 = ( ( oj + node.ny - 2 ) / 2 < lay.Y() - 1 ) ? ( oj + node.ny - 2 ) / 2 : lay.Y() - 1;
+		cint k0 = ( ok / 2 > 1 ) ? ok / 2 : 1, k1 = ( ( ok + node.nz - 2 ) / 2 < lay.Z() - 1 ) ? ( ok + node.nz - 2 ) / 2 : lay.Z() - 1;
+
+		for ( int k = k0; k < k1; k++ ) for ( int j = j0; j < j1; j++ ) for ( int i = i0; i < i1; i++ )
+		{
+			if ( not atomicWritable( lay, i, j, k ) ) continue;
+
+			/* the first of the eight fine cells, in the cells of node */
+			cint x = 2 * i - oi + 1, y = 2 * j - oj + 1, z = 2 * k - ok + 1;
+
+			for ( int f = 0; f < count; f++ )
+			{
+				const T *fine = in[f];
+				out[f][ lay.ix(i,j,k) ] = (T)0.125 * (
+					fine[node.ix(x, y, z)]         + fine[node.ix(x + 1, y, z)] +
+					fine[node.ix(x, y + 1, z)]     + fine[node.ix(x + 1, y + 1, z)] +
+					fine[node.ix(x, y, z + 1)]     + fine[node.ix(x + 1, y, z + 1)] +
+					fine[node.ix(x, y + 1, z + 1)] + fine[node.ix(x + 1, y + 1, z + 1)] );
+			}
+		}
+	};
+
+
+	/* what kernelReduce makes of the cells */
+	enum REDUCTION
+	{
+		REDUCE_SUM     = 0, // their sum, in double
+		REDUCE_MAX     = 1, // the largest of them
+		REDUCE_NONZERO = 2, // how many are not zero
+	};
+
+
+	inline double atomicReduceInit( const REDUCTION op )
+	{
+		return ( op eqt REDUCE_MAX ) ? -HUGE_VAL : 0.0;
+	};
+
+
+	/* a cell, or a partial, into the partial a, for partials b they are combined */
+	inline double atomicReduce( const REDUCTION op, cdouble a, cdouble b, const bool partial )
+	{
+		if ( op eqt REDUCE_MAX ) return ( b > a ) ? b : a;
+		if ( op eqt REDUCE_NONZERO and not partial ) return a + ( b not_eq 0.0 ? 1.0 : 0.0 );
+		return a + b;
+	};
+
+
+	/* the second stage of a reduction: the count partials combined in pairs, the  *
+	 * neighbours first, so the tree depends on count alone and the rounding of a  *
+	 * sum is the same for any number of threads; partial is overwritten           */
+	inline double atomicReduceTree( const REDUCTION op, double *partial, cint count )
+	{
+		if ( count <= 0 ) return atomicReduceInit( op );
+
+		for ( int stride = 1; stride < count; stride *= 2 )
+			for ( int n = 0; n + stride < count; n += 2 * stride )
+				partial[n] = atomicReduce( op, partial[n], partial[n + stride], true );
+
+		return partial[0];
+	};
+
+
+	/* reduce the cells [i0, i1) x [j0, j1) x [k0, k1) of field; the first stage leaves *
+	 * one partial per slab, reduced in order by whichever thread gets it, the second  *
+	 * combines them in a fixed tree, so the result is bit for bit the same for any    *
+	 * number of threads                                                               */
+	template <class L, typename T>
+	double kernelReduceBox( const L &lay, ThreadPool &pool, const REDUCTION op, const T *field,
+		cint i0, cint i1, cint j0, cint j1, cint k0, cint k1 )
+	{
+		if ( k1 <= k0 ) return atomicReduceInit( op );
+
+		std::vector<double> partial( k1 - k0 );
+
+		pool.ParallelFor( k0, k1, [&]( int first, int last )
+		{
+			for ( int k = first; k < last; k++ )
+			{
+				double acc = atomicReduceInit( op );
+				for ( int j = j0; j < j1; j++ ) for ( int i = i0; i < i1; i++ )
+					acc = atomicReduce( op, acc, (double)field[lay.ix(i,j,k)], false );
+				partial[k - k0] = acc;
+			}
+		} );
+
+		return atomicReduceTree( op, &partial[0], k1 - k0 );
+	};
+
+
+	/* kernelReduceBox of the cells at least margin cells away from the sides of lay, *
+	 * 0 taking them all and 1 the interior                                           */
+	template <class L, typename T>
+	double kernelReduce( const L &lay, ThreadPool &pool, const REDUCTION op, const T *field, cint margin )
+	{
+		return kernelReduceBox( lay, pool, op, field,
+			margin, lay.X() - margin, margin, lay.Y() - margin, margin, lay.Z() - margin );
+	};
+
+
+	/* the same kernels on the rows of a vector instruction set, see Simd.h */
+
+	/* only red-black and Jacobi, the lexicographic Gauss-Seidel sweep depends *
+	 * on the cell updated just before, and has no vector form                 */
+	template <typename T>
+	void kernelJacobi
+		( const GridLayout &lay, ThreadPool &pool, const RELAXATION mode, const STENCILROWS<T> &rows,
+		T *out, const T *in, T *scratch, cdouble rate, cdouble divisor )
+	{
+		const T diff = (T)rate;
+		const T dix  = ( divisor > 0 ) ? (T)divisor : 1.f;
+
+		if ( mode eqt RELAX_RED_BLACK )
+		{
+			for ( int n = 0; n < 10; n++ ) for ( int color = 0; color < 2; color++ )
+			{
+				pool.ParallelFor( 1, lay.Z() - 1, [&]( int k0, int k1 )
+				{
+					for ( int k = k0; k < k1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+					{
+						size_t row = lay.ix( 0, j, k );
+						rows.jacobi( out + row, out + row, in + row, lay.SX(), lay.SXY(),
+							1 + ( ( 1 + j + k + color ) & 1 ), lay.X() - 1, 2, diff, dix );
+					}
+				} );
+			}
+		}
+		else
+		{
+			memcpy( scratch, out, lay.Elements() * sizeof(T) );
+
+			T *src = out, *dst = scratch;
+			for ( int n = 0; n < 10; n++ )
+			{
+				pool.ParallelFor( 1, lay.Z() - 1, [&]( int k0, int k1 )
+				{
+					for ( int k = k0; k < k1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+					{
+						size_t row = lay.ix( 0, j, k );
+						rows.jacobi( dst + row, src + row, in + row, lay.SX(), lay.SXY(),
+							1, lay.X() - 1, 1, diff, dix );
+					}
+				} );
+				std::swap( src, dst );
+			}
+
+			if ( src not_eq out ) memcpy( out, src, lay.Elements() * sizeof(T) );
+		}
+	};
+
+
+	template <typename T>
+	void kernelGradient
+		( const GridLayout &lay, const STENCILROWS<T> &rows, T *div, T *prs, const T *u, const T *v, const T *w )
+	{
+		for ( int k = 1; k < lay.Z() - 1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+		{
+			size_t row = lay.ix( 0, j, k );
+			rows.gradient( div + row, prs + row, u + row, v + row, w + row, lay.SX(), lay.SXY(),
+				1, lay.X() - 1, (T)lay.X(), (T)lay.Y(), (T)lay.Z() );
+		}
+	};
+
+
+	template <typename T>
+	void kernelSubtract
+		( const GridLayout &lay, const STENCILROWS<T> &rows, T *u, T *v, T *w, const T *prs )
+	{
+		for ( int k = 1; k < lay.Z() - 1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+		{
+			size_t row = lay.ix( 0, j, k );
+			rows.subtract( u + row, v + row, w + row, prs + row, lay.SX(), lay.SXY(),
+				1, lay.X() - 1, (T)( 0.5f * lay.X() ), (T)( 0.5f * lay.Y() ), (T)( 0.5f * lay.Z() ) );
+		}
+	};
+
+
+	/* the layout needs a halo, see atomicCell */
+	template <typename T>
+	void kernelAdvection
+		( const GridLayout &lay, const STENCILROWS<T> &rows, T *out, const T *in,
+		const T *u, const T *v, const T *w, cdouble dt )
+	{
+		for ( int k = 1; k < lay.Z() - 1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+		{
+			size_t row = lay.ix( 0, j, k );
+			rows.advection( out + row, in + row, u + row, v + row, w + row, lay.SX(), lay.SXY(),
+				j, k, 1, lay.X() - 1, (T)dt, lay.X(), lay.Y(), lay.Z() );
+		}
+	};
+
+
+	template <typename T>
+	void kernelVectorAdvection
+		( const GridLayout &lay, const STENCILROWS<T> &rows, T *outu, T *outv, T *outw,
+		const T *u, const T *v, const T *w, cdouble dt )
+	{
+		for ( int k = 1; k < lay.Z() - 1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+		{
+			size_t row = lay.ix( 0, j, k );
+			rows.vectoradvection( outu + row, outv + row, outw + row, u + row, v + row, w + row,
+				lay.SX(), lay.SXY(), j, k, 1, lay.X() - 1, (T)dt, lay.X(), lay.Y(), lay.Z() );
+		}
+	};
+
+
+	/* temporal blocking: plane( s, k ) runs sweep s on the interior plane k, for sweeps  *
+	 * s of [0, sweeps), depth of them per pass over the grid. sweep s of plane k waits   *
+	 * for sweep s - 1 of planes k - 1 to k + 1 and is done before sweep s + 1 of plane   *
+	 * k - 1, which holds for each of the three orderings of kernelJacobi, so the result  *
+	 * is the same as sweeping the whole grid again and again; running sweep s on plane   *
+	 * t - 2s at step t keeps the planes of one step two apart, and thus independent, so  *
+	 * they go to the pool together. each pass streams the grid through the cache once,   *
+	 * keeping about 2 * depth planes resident instead of one; but no more than depth     *
+	 * planes run at a time, with the pool waiting for them at every step, so on more     *
+	 * cores than depth it is slower than the plain sweeps; TEMPORAL_DEPTH leaves it off */
+	template <class F>
+	void kernelWavefront( ThreadPool &pool, cint nz, cint sweeps, cint depth, const F &plane )
+	{
+		for ( int first = 0; first < sweeps; first += depth )
+		{
+			cint count = ( sweeps - first < depth ) ? sweeps - first : depth;
+
+			for ( int t = 1; t < nz - 1 + 2 * ( count - 1 ); t++ )
+			{
+				/* the sweeps with 1 <= t - 2s <= nz - 2 */
+				int s0 = ( t - ( nz - 2 ) + 1 ) / 2;
+				int s1 = ( t - 1 ) / 2 + 1;
+				if ( s0 < 0 ) s0 = 0;
+				if ( s1 > count ) s1 = count;
+
+				pool.ParallelFor( s0, s1, [&]( int h0, int h1 )
+				{
+					for ( int h = h0; h < h1; h++ ) plane( first + h, t - 2 * h );
+				} );
+			}
+		}
+	};
+
+
+	/* kernelJacobi with depth sweeps per pass over the grid, bit for bit the same result; *
+	 * rows may be NULL for the scalar rows, Gauss-Seidel always takes those              */
+	template <class L, typename T>
+	void kernelJacobiBlocked
+		( const L &lay, ThreadPool &pool, const RELAXATION mode, const STENCILROWS<T> *rows,
+		T *out, const T *in, T *scratch, cdouble rate, cdouble divisor, cint depth )
+	{
+		const T diff = (T)rate;
+		const T dix  = ( divisor > 0 ) ? (T)divisor : 1.f;
+
+		/* the vector rows need rows in memory, which every layout but BrickLayout has */
+		const ptrdiff_t sx  = lay.ix( 0, 1, 0 ) - lay.ix( 0, 0, 0 );
+		const ptrdiff_t sxy = lay.ix( 0, 0, 1 ) - lay.ix( 0, 0, 0 );
+
+		/* plane k of out to scratch */
+		auto copyplane = [&]( int k )
+		{
+			for ( int j = 0; j < lay.Y(); j++ ) for ( int i = 0; i < lay.X(); i++ )
+				scratch[lay.ix( i, j, k )] = out[lay.ix( i, j, k )];
+		};
+
+		if ( mode eqt RELAX_GAUSS_SEIDEL )
+		{
+			kernelWavefront( pool, lay.Z(), 10, depth, [&]( int s, int k )
+			{
+				for ( int j = 1; j < lay.Y() - 1; j++ )
+					atomicJacobiRow( lay, out, out, in, diff, dix, j, k, 1, 1 );
+			} );
+		}
+		elif ( mode eqt RELAX_RED_BLACK )
+		{
+			/* a sweep of each color is a step of the wavefront */
+			kernelWavefront( pool, lay.Z(), 20, depth, [&]( int s, int k )
+			{
+				for ( int j = 1; j < lay.Y() - 1; j++ )
+				{
+					int i0 = 1 + ( ( 1 + j + k + ( s & 1 ) ) & 1 );
+					if ( rows not_eq NULL )
+					{
+						size_t row = lay.ix( 0, j, k );
+						rows->jacobi( out + row, out + row, in + row, sx, sxy, i0, lay.X() - 1, 2, diff, dix );
+					}
+					else atomicJacobiRow( lay, out, out, in, diff, dix, j, k, i0, 2 );
+				}
+			} );
+		}
+		else
+		{
+			/* the boundary cells of scratch have to match those of out, the interior *
+			 * planes are copied by the first sweep, when they are in cache anyway     */
+			copyplane( 0 );
+			copyplane( lay.Z() - 1 );
+
+			kernelWavefront( pool, lay.Z(), 10, depth, [&]( int s, int k )
+			{
+				T *src = ( s & 1 ) ? scratch : out;
+				T *dst = ( s & 1 ) ? out : scratch;
+
+				if ( s eqt 0 ) copyplane( k );
+
+				for ( int j = 1; j < lay.Y() - 1; j++ )
+				{
+					if ( rows not_eq NULL )
+					{
+						size_t row = lay.ix( 0, j, k );
+						rows->jacobi( dst + row, src + row, in + row, sx, sxy, 1, lay.X() - 1, 1, diff, dix );
+					}
+					else atomicJacobiRow( lay, dst, src, in, diff, dix, j, k, 1, 1 );
+				}
+			} );
+		}
+	};
+
+
+	/* the kernels above on the active bricks of a SparseLayout, chosen over the     *
+	 * templates by overloading; each cell computes the same expression, the cells  *
+	 * of the inactive bricks read zero and are never written                       */
+
+	/* row( j, k, i0, i1 ) for the rows of the active bricks b0 to b1, without the *
+	 * edge outermost shells of cells of the grid                                  */
+	template <class F>
+	inline void atomicBricks( const SparseLayout &lay, cint b0, cint b1, cint edge, const F &row )
+	{
+		const std::vector<int> &active = lay.map->Active();
+
+		for ( int b = b0; b < b1; b++ )
+		{
+			int i0, j0, k0;
+			lay.map->Origin( active[b], i0, j0, k0 );
+
+			cint i1 = ( i0 + BRICK_EDGE < lay.X() - edge ) ? i0 + BRICK_EDGE : lay.X() - edge;
+			cint j1 = ( j0 + BRICK_EDGE < lay.Y() - edge ) ? j0 + BRICK_EDGE : lay.Y() - edge;
+			cint k1 = ( k0 + BRICK_EDGE < lay.Z() - edge ) ? k0 + BRICK_EDGE : lay.Z() - edge;
+
+			for ( int k = ( k0 > edge ? k0 : edge ); k < k1; k++ ) for ( int j = ( j0 > edge ? j0 : edge ); j < j1; j++ )
+				row( j, k, ( i0 > edge ? i0 : edge ), i1 );
+		}
+	};
+
+
+	/* the interior rows of all active bricks, spread over the pool */
+	template <class F>
+	void kernelBricks( const SparseLayout &lay, ThreadPool &pool, const F &row )
+	{
+		pool.ParallelFor( 0, (int)lay.map->Active().size(), [&]( int b0, int b1 )
+		{
+			atomicBricks( lay, b0, b1, 1, row );
+		} );
+	};
+
+
+	/* cell( i, j, k ) for every cell of the grid, boundary included, which may hold *
+	 * anything but zero; all of them but for SparseLayout                           */
+	template <class L, class F>
+	inline void atomicCells( const L &lay, const F &cell )
+	{
+		for ( int k = 0; k < lay.Z(); k++ ) for ( int j = 0; j < lay.Y(); j++ ) for ( int i = 0; i < lay.X(); i++ )
+			cell( i, j, k );
+	};
+
+
+	template <class F>
+	inline void atomicCells( const SparseLayout &lay, const F &cell )
+	{
+		atomicBricks( lay, 0, (int)lay.map->Active().size(), 0, [&]( int j, int k, int i0, int i1 )
+		{
+			for ( int i = i0; i < i1; i++ ) cell( i, j, k );
+		} );
+	};
+
+
+	/* the density as the bytes of the volume texture, packed in rows without the *
+	 * ghost cells whatever the layout, those outside ( 0, 250 ) left empty; a     *
+	 * sparse grid writes its active bricks only, the rest is left as it was       */
+	template <class L, typename T>
+	void kernelVolume( const L &lay, uchar *volume, const T *den )
+	{
+		atomicCells( lay, [&]( int i, int j, int k )
+		{
+			volume[ ( (size_t)k * lay.Y() + j ) * lay.X() + i ] = ( den[lay.ix(i,j,k)] > 0.f and den[lay.ix(i,j,k)] < 250.f ) ?
+				(uchar)den[lay.ix(i,j,k)] : 0;
+		} );
+	};
+
+
+	/* a row of a brick from i0 to i1 - 1 is contiguous, and so are the rows next to *
+	 * it along y and z, in whatever brick they lie; only the cells before i0 and    *
+	 * after i1 - 1 may be in other bricks                                           */
+	struct SPARSEROW
+	{
+		int c;      // cell i0
+		int ym, yp; // cell i0 of the rows j - 1 and j + 1
+		int zm, zp; // cell i0 of the rows k - 1 and k + 1
+		int xm, xp; // cells i0 - 1 and i1
+		int last;   // i1 - 1 - i0
+
+		SPARSEROW( const SparseLayout &lay, cint j, cint k, cint i0, cint i1 )
+			: c(lay.ix( i0, j, k )), ym(lay.ix( i0, j - 1, k )), yp(lay.ix( i0, j + 1, k )),
+			zm(lay.ix( i0, j, k - 1 )), zp(lay.ix( i0, j, k + 1 )),
+			xm(lay.ix( i0 - 1, j, k )), xp(lay.ix( i1, j, k )), last(i1 - 1 - i0) {};
+
+		/* the neighbours along x of cell i0 + n */
+		inline int XM( cint n ) const { return ( n > 0 ) ? c + n - 1 : xm; };
+		inline int XP( cint n ) const { return ( n < last ) ? c + n + 1 : xp; };
+	};
+
+
+	template <typename T>
+	void kernelAdvection
+		( const SparseLayout &lay, T *out, const T *in, const T *u, const T *v, const T *w, cdouble dt )
+	{
+		const T h = (T)dt;
+
+		atomicBricks( lay, 0, (int)lay.map->Active().size(), 1, [&]( int j, int k, int i0, int i1 )
+		{
+			cint c = lay.ix( i0, j, k );
+
+			for ( int i = i0; i < i1; i++ )
+			{
+				const size_t id = c + i - i0;
+
+				T velu = i - u[id] * h;
+				T velv = j - v[id] * h;
+				T velw = k - w[id] * h;
+
+				out[id] = atomicTrilinear( lay, in, velu, velv, velw );
+			}
+		} );
+	};
+
+
+	template <typename T>
+	void kernelVectorAdvection
+		( const SparseLayout &lay, T *outu, T *outv, T *outw, const T *u, const T *v, const T *w, cdouble dt )
+	{
+		const T h = (T)dt;
+
+		atomicBricks( lay, 0, (int)lay.map->Active().size(), 1, [&]( int j, int k, int i0, int i1 )
+		{
+			cint c = lay.ix( i0, j, k );
+
+			for ( int i = i0; i < i1; i++ )
+			{
+				const size_t id = c + i - i0;
+
+				T velu = i - u[id] * h;
+				T velv = j - v[id] * h;
+				T velw = k - w[id] * h;
+
+				atomicTrilinearVector( lay, u, v, w, velu, velv, velw, outu[id], outv[id], outw[id] );
+			}
+		} );
+	};
+
+
+	/* Gauss-Seidel has no lexicographic order across the bricks and runs red-black */
+	template <typename T>
+	void kernelJacobi
+		( const SparseLayout &lay, ThreadPool &pool, const RELAXATION mode,
+		T *out, const T *in, T *scratch, cdouble rate, cdouble divisor )
+	{
+		const T diff = (T)rate;
+		const T dix  = ( divisor > 0 ) ? (T)divisor : 1.f;
+
+		auto relax = [&]( T *dst, const T *src, cint j, cint k, cint i0, cint i1, cint first, cint step )
+		{
+			const SPARSEROW r( lay, j, k, i0, i1 );
+
+			for ( int n = first; n <= r.last; n += step )
+			{
+				dst[r.c + n] = (
+					in[r.c + n] + diff * (
+					src[r.XM( n )] + src[r.XP( n )] +
+					src[r.ym + n] + src[r.yp + n] +
+					src[r.zm + n] + src[r.zp + n] 	)) / dix;
+			}
+		};
+
+		if ( mode not_eq RELAX_JACOBI )
+		{
+			for ( int n = 0; n < 10; n++ ) for ( int color = 0; color < 2; color++ )
+			{
+				kernelBricks( lay, pool, [&]( int j, int k, int i0, int i1 )
+				{
+					/* the cells with i + j + k + color even, as in kernelJacobi */
+					relax( out, out, j, k, i0, i1, ( i0 + j + k + color ) & 1, 2 );
+				} );
+			}
+		}
+		else
+		{
+			/* the active bricks of scratch have to match those of out, the *
+			 * slots are the same in every field                            */
+			const std::vector<int> &active = lay.map->Active();
+			for ( size_t b = 0; b < active.size(); b++ )
+			{
+				const size_t first = (size_t)lay.slot[ active[b] ] * BRICK_CELLS;
+				memcpy( scratch + first, out + first, BRICK_CELLS * sizeof(T) );
+			}
+
+			T *src = out, *dst = scratch;
+			for ( int n = 0; n < 10; n++ )
+			{
+				kernelBricks( lay, pool, [&]( int j, int k, int i0, int i1 )
+				{
+					relax( dst, src, j, k, i0, i1, 0, 1 );
+				} );
+				std::swap( src, dst );
+			}
+
+			if ( src not_eq out )
+			{
+				for ( size_t b = 0; b < active.size(); b++ )
+				{
+					const size_t first = (size_t)lay.slot[ active[b] ] * BRICK_CELLS;
+					memcpy( out + first, src + first, BRICK_CELLS * sizeof(T) );
+				}
+			}
+		}
+	};
+
+
+	/* the active bricks are few enough to stay in cache, there is nothing to block */
+	template <typename T>
+	void kernelJacobiBlocked
+		( const SparseLayout &lay, ThreadPool &pool, const RELAXATION mode, const STENCILROWS<T> *rows,
+		T *out, const T *in, T *scratch, cdouble rate, cdouble divisor, cint depth )
+	{
+		kernelJacobi( lay, pool, mode, out, in, scratch, rate, divisor );
+	};
+
+
+	template <typename T>
+	void kernelGradient
+		( const SparseLayout &lay, T *div, T *prs, const T *u, const T *v, const T *w )
+	{
+		atomicBricks( lay, 0, (int)lay.map->Active().size(), 1, [&]( int j, int k, int i0, int i1 )
+		{
+			const SPARSEROW r( lay, j, k, i0, i1 );
+
+			for ( int n = 0; n <= r.last; n++ )
+			{
+				div[r.c + n] = (T) ( -1.f / 3.f * (
+					( u[r.XP( n )] - u[r.XM( n )] ) / (T)lay.X() +
+					( v[r.yp + n] - v[r.ym + n] ) / (T)lay.Y() +
+					( w[r.zp + n] - w[r.zm + n] ) / (T)lay.Z() ));
+
+				prs[r.c + n] = 0.f;
+			}
+		} );
+	};
+
+
+	template <typename T>
+	void kernelSubtract
+		( const SparseLayout &lay, T *u, T *v, T *w, const T *prs )
+	{
+		atomicBricks( lay, 0, (int)lay.map->Active().size(), 1, [&]( int j, int k, int i0, int i1 )
+		{
+			const SPARSEROW r( lay, j, k, i0, i1 );
+
+			for ( int n = 0; n <= r.last; n++ )
+			{
+				u[r.c + n] -= 0.5f * lay.X() * ( prs[r.XP( n )] - prs[r.XM( n )] );
+				v[r.c + n] -= 0.5f * lay.Y() * ( prs[r.yp + n] - prs[r.ym + n] );
+				w[r.c + n] -= 0.5f * lay.Z() * ( prs[r.zp + n] - prs[r.zm + n] );
+			}
+		} );
+	};
+};
+
+#endif
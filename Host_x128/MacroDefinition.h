@@ -18,6 +18,7 @@
 #define GRIDS_X              128
 #define GRIDS_Y              128
 #define GRIDS_Z              128
+#define GRIDS_HALO             1
 
 #define BULLET_X             130
 #define BULLET_Y             130
@@ -34,6 +35,20 @@
 #define TILE_X                32
 #define TILE_Y                32
 
+#define TEMPORAL_DEPTH         0
+
+#define SPARSE_SLOTS          64
+#define SPARSE_EPSILON      1e-4f
+
+#define NODES_X                4
+#define NODES_Y                4
+#define NODES_Z                4
+#define NODES_GATE          2.5f
+
+#define SNAPSHOT_FILE "stage.snap"
+
+#define EXPORT_DEPTH           4
+
 #define WINDOWS_X            400
 #define WINDOWS_Y            400
 
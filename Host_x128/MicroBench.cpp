@@ -0,0 +1,412 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     MicroBench.cpp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include "MacroDefinition.h"
+#include "GridLayout.h"
+#include "Kernels.h"
+#include "FluidSimProc.h"
+#include "Simd.h"
+#include "ThreadPool.h"
+#include "StopWatch.h"
+
+using namespace sge;
+using std::vector;
+using std::string;
+
+#define KERNEL_TRILINEAR 0
+#define KERNEL_JACOBI    1
+#define KERNEL_ADVECTION 2
+#define KERNEL_GRADIENT  3
+#define KERNEL_SUBTRACT  4
+#define KERNEL_UPSCALING 5
+#define KERNEL_VOLUME    6
+#define KERNELS          7
+
+static const char *t_kernelname[KERNELS] =
+	{ "trilinear", "jacobi", "advection", "gradient", "subtract", "upscaling", "volume" };
+
+/* fields of the grid each kernel touches, and the bytes it has to move per cell *
+ * and field element, reads and writes counted once, as STREAM counts them; the *
+ * neighbours of the stencils are taken to come from the caches                 */
+static const int    t_fields[KERNELS] = { 1, 3, 5, 5, 4, 1, 1 };
+static const double t_traffic[KERNELS] = { 1.0, 30.0, 5.0, 5.0, 7.0, 9.0, 1.0 };
+
+/* the upsampled grid is 8 times the cells of the fields above */
+#define UPSCALED_FIELDS 8
+
+
+static void Usage( const char *app )
+{
+	printf( "usage: %s [-g n[,n...]] [-s double|float[,...]] [-k kernel[,kernel...]] [-t threads]\n"
+		"       [-i scalar|avx2|avx512] [-b depth] [-m MB] [-e seconds] [-c file.csv]\n"
+		"  -g  cubic grid extents, default 32,64,128,256,512\n"
+		"  -s  storage precisions, default double,float\n"
+		"  -k  kernels among trilinear, jacobi, advection, gradient, subtract, upscaling\n"
+		"      and volume, default all\n"
+		"  -t  worker threads of the pool, 0 for one per core, default 0\n"
+		"  -i  instruction set of the stencils, default the widest the CPU supports\n"
+		"  -b  Jacobi sweeps per pass over the grid, 0 for one, default %d; a depth\n"
+		"      keeps no more than that many threads busy\n"
+		"  -m  memory the fields may take, larger runs are skipped, default 3/4 of RAM\n"
+		"  -e  seconds each kernel is repeated for at least, default 0.25\n"
+		"  -c  write the results as CSV\n",
+		app, TEMPORAL_DEPTH );
+};
+
+
+/* the comma separated values of a list argument */
+static vector<string> Split( const char *list )
+{
+	vector<string> items;
+	string item;
+
+	for ( const char *c = list; ; c++ )
+	{
+		if ( *c eqt ',' or *c eqt '\0' )
+		{
+			if ( not item.empty() ) items.push_back( item );
+			item.clear();
+			if ( *c eqt '\0' ) break;
+		}
+		else item += *c;
+	}
+
+	return items;
+};
+
+
+/* median seconds of job, repeated at least 3 times and for at least least seconds */
+static double Median( const std::function<void( void )> &job, cdouble least )
+{
+	vector<double> samples;
+	StopWatch watch, total;
+
+	/* the first touches the pages and warms the caches */
+	job();
+
+	total.Start();
+	while ( samples.size() < 3 or total.Elapsed() < least )
+	{
+		watch.Start();
+		job();
+		samples.push_back( watch.Elapsed() );
+	}
+
+	std::sort( samples.begin(), samples.end() );
+	return samples[ samples.size() / 2 ];
+};
+
+
+/* GB/s of the STREAM triad a = b + s * c over arrays far larger than the caches, *
+ * on the threads of the pool, the best of a few runs as STREAM reports it        */
+static double Stream( ThreadPool &pool, const size_t count )
+{
+	vector<double> a( count, 0.0 ), b( count, 1.0 ), c( count, 2.0 );
+	cint chunks = 1024;
+	double best = 0.f;
+
+	for ( int n = 0; n < 5; n++ )
+	{
+		StopWatch watch;
+
+		pool.ParallelFor( 0, chunks, [&]( int c0, int c1 )
+		{
+			const size_t first = count * c0 / chunks, last = count * c1 / chunks;
+			for ( size_t i = first; i < last; i++ ) a[i] = b[i] + 3.0 * c[i];
+		} );
+
+		double gbs = 3.0 * count * sizeof(double) / watch.Elapsed() / 1e9;
+		if ( gbs > best ) best = gbs;
+	}
+
+	return best;
+};
+
+
+/* memory the machine has, or 4 GB where it cannot tell */
+static double PhysicalMB( void )
+{
+#if defined(_SC_PHYS_PAGES) and defined(_SC_PAGESIZE)
+	return (double)sysconf( _SC_PHYS_PAGES ) * sysconf( _SC_PAGESIZE ) / 1048576.0;
+#else
+	return 4096.0;
+#endif
+};
+
+
+/* smooth fields, so that the backtraces of the advection stay within a cell or two */
+template <typename T>
+static void Fill( const GridLayout &grid, T *field, cdouble phase, cdouble scale )
+{
+	for ( int k = 0; k < grid.nz; k++ ) for ( int j = 0; j < grid.ny; j++ ) for ( int i = 0; i < grid.nx; i++ )
+		field[ grid.ix(i,j,k) ] = (T)( scale * sin( 0.1 * i + phase ) * cos( 0.07 * j - phase ) * sin( 0.05 * k + 2 * phase ) );
+};
+
+
+/* median seconds of kernel on an n^3 grid of T */
+template <typename T>
+static double Measure( cint kernel, cint n, ThreadPool &pool, const SIMD simd, cint depth, cdouble least )
+{
+	GridLayout grid( n, n, n, GRIDS_HALO );
+	const STENCILROWS<T> *rows = StencilRows<T>( simd );
+	const size_t elements = grid.Elements();
+
+	vector<T*> f( t_fields[kernel] );
+	for ( size_t i = 0; i < f.size(); i++ )
+	{
+		f[i] = (T*) calloc( elements, sizeof(T) );
+		if ( f[i] eqt NULL ) { for ( size_t j = 0; j < i; j++ ) free( f[j] ); return -1.f; }
+		Fill( grid, f[i], 0.7 * i, ( kernel eqt KERNEL_VOLUME ) ? 200.0 : 1.0 );
+	}
+
+	double seconds = -1.f;
+
+	switch ( kernel )
+	{
+	case KERNEL_TRILINEAR:
+		{
+			/* every cell sampled a fraction of a cell away, summed so nothing is elided */
+			volatile T sink = 0.f;
+			seconds = Median( [&]( void )
+			{
+				T sum = 0.f;
+				DISPATCH_LAYOUT( grid,
+					for ( int k = 1; k < n - 1; k++ ) for ( int j = 1; j < n - 1; j++ ) for ( int i = 1; i < n - 1; i++ )
+						sum += atomicTrilinear( lay, f[0], (T)( i + 0.3 ), (T)( j - 0.4 ), (T)( k + 0.2 ) ) );
+				sink = sink + sum;
+			}, least );
+		}
+		break;
+
+	case KERNEL_JACOBI:
+		/* as FluidSimProc::Jacobi does it, red-black, f[2] the scratch */
+		seconds = Median( [&]( void )
+		{
+			if ( depth > 0 )
+			{
+				DISPATCH_LAYOUT( grid, kernelJacobiBlocked( lay, pool, RELAX_RED_BLACK, rows, f[0], f[1], f[2], 0.2, 2.2, depth ) );
+			}
+			elif ( rows not_eq NULL )
+			{
+				kernelJacobi( grid, pool, RELAX_RED_BLACK, *rows, f[0], f[1], f[2], 0.2, 2.2 );
+			}
+			else
+			{
+				DISPATCH_LAYOUT( grid, kernelJacobi( lay, pool, RELAX_RED_BLACK, f[0], f[1], f[2], 0.2, 2.2 ) );
+			}
+		}, least );
+		break;
+
+	case KERNEL_ADVECTION:
+		seconds = Median( [&]( void )
+		{
+			if ( rows not_eq NULL )
+				kernelAdvection( grid, *rows, f[0], f[1], f[2], f[3], f[4], DELTATIME );
+			else
+				DISPATCH_LAYOUT( grid, kernelAdvection( lay, f[0], f[1], f[2], f[3], f[4], DELTATIME ) );
+		}, least );
+		break;
+
+	case KERNEL_GRADIENT:
+		seconds = Median( [&]( void )
+		{
+			if ( rows not_eq NULL )
+				kernelGradient( grid, *rows, f[0], f[1], f[2], f[3], f[4] );
+			else
+				DISPATCH_LAYOUT( grid, kernelGradient( lay, f[0], f[1], f[2], f[3], f[4] ) );
+		}, least );
+		break;
+
+	case KERNEL_SUBTRACT:
+		seconds = Median( [&]( void )
+		{
+			if ( rows not_eq NULL )
+				kernelSubtract( grid, *rows, f[0], f[1], f[2], f[3] );
+			else
+				DISPATCH_LAYOUT( grid, kernelSubtract( lay, f[0], f[1], f[2], f[3] ) );
+		}, least );
+		break;
+
+	case KERNEL_UPSCALING:
+		{
+			/* the whole grid upsampled as one subnode, the fine grid of the two-level scheme */
+			GridLayout fine( 2 * n, 2 * n, 2 * n, GRIDS_HALO );
+			T *out = (T*) calloc( fine.Elements(), sizeof(T) );
+			if ( out eqt NULL ) break;
+
+			seconds = Median( [&]( void )
+			{
+				const T *in = f[0];
+				DISPATCH_LAYOUT( grid, kernelUpScaling( lay, fine, &out, &in, 1, 1, 1, 1 ) );
+			}, least );
+
+			free( out );
+		}
+		break;
+
+	case KERNEL_VOLUME:
+		{
+			vector<uchar> volume( grid.Cells() );
+			seconds = Median( [&]( void )
+			{
+				DISPATCH_LAYOUT( grid, kernelVolume( lay, &volume[0], f[0] ) );
+			}, least );
+		}
+		break;
+	}
+
+	for ( size_t i = 0; i < f.size(); i++ ) free( f[i] );
+
+	return seconds;
+};
+
+
+/* each kernel of the solver alone, over a range of grids in both precisions, *
+ * reported as cells per second and as the GB/s its compulsory traffic takes, *
+ * against the bandwidth the machine reaches at all                           */
+int main( int argc, char **argv )
+{
+	vector<int> grids, kernels;
+	vector<SCALAR> scalars;
+	int threads = 0, depth = TEMPORAL_DEPTH;
+	SIMD simd = DetectSimd();
+	double budget = PhysicalMB() * 0.75, least = 0.25;
+	const char *csv = NULL;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		string opt = argv[i];
+		const char *val = ( i + 1 < argc ) ? argv[i + 1] : NULL;
+
+		if ( val eqt NULL ) { Usage( argv[0] ); return 1; }
+
+		if ( opt eqt "-t" ) threads = atoi( val );
+		elif ( opt eqt "-b" ) depth = atoi( val );
+		elif ( opt eqt "-m" ) budget = atof( val );
+		elif ( opt eqt "-e" ) least = atof( val );
+		elif ( opt eqt "-c" ) csv = val;
+		elif ( opt eqt "-g" )
+		{
+			vector<string> items = Split( val );
+			for ( size_t n = 0; n < items.size(); n++ ) grids.push_back( atoi( items[n].c_str() ) );
+		}
+		elif ( opt eqt "-s" )
+		{
+			vector<string> items = Split( val );
+			for ( size_t n = 0; n < items.size(); n++ )
+			{
+				if ( items[n] eqt "double" ) scalars.push_back( SCALAR_DOUBLE );
+				elif ( items[n] eqt "float" ) scalars.push_back( SCALAR_FLOAT );
+				else { Usage( argv[0] ); return 1; }
+			}
+		}
+		elif ( opt eqt "-k" )
+		{
+			vector<string> items = Split( val );
+			for ( size_t n = 0; n < items.size(); n++ )
+			{
+				int k = 0;
+				while ( k < KERNELS and items[n] not_eq t_kernelname[k] ) k++;
+				if ( k eqt KERNELS ) { Usage( argv[0] ); return 1; }
+				kernels.push_back( k );
+			}
+		}
+		elif ( opt eqt "-i" )
+		{
+			string mode = val;
+			if ( mode eqt "scalar" ) simd = SIMD_SCALAR;
+			elif ( mode eqt "avx2" ) simd = SIMD_AVX2;
+			elif ( mode eqt "avx512" ) simd = SIMD_AVX512;
+			else { Usage( argv[0] ); return 1; }
+		}
+		else { Usage( argv[0] ); return 1; }
+
+		i++;
+	}
+
+	if ( grids.empty() ) for ( int n = 32; n <= 512; n *= 2 ) grids.push_back( n );
+	if ( scalars.empty() ) { scalars.push_back( SCALAR_DOUBLE ); scalars.push_back( SCALAR_FLOAT ); }
+	if ( kernels.empty() ) for ( int k = 0; k < KERNELS; k++ ) kernels.push_back( k );
+	for ( size_t g = 0; g < grids.size(); g++ ) if ( grids[g] < 3 ) { Usage( argv[0] ); return 1; }
+
+	if ( simd > DetectSimd() ) simd = DetectSimd();
+
+	ThreadPool pool( threads );
+
+	/* three arrays of a quarter of the budget at most, and 64M doubles at least */
+	size_t count = (size_t)( budget * 1048576.0 / 4 / 3 / sizeof(double) );
+	if ( count > ( (size_t)64 << 20 ) ) count = (size_t)64 << 20;
+	const double ceiling = Stream( pool, count );
+
+	printf( "%d thread(s), %s, STREAM triad %.2f GB/s, fields up to %.0f MB\n\n", pool.Threads(),
+		simd eqt SIMD_AVX512 ? "avx512" : simd eqt SIMD_AVX2 ? "avx2" : "scalar", ceiling, budget );
+
+	printf( "%-10s %6s %-7s %12s %12s %10s %9s\n", "kernel", "grid", "scalar", "time(ms)", "Mcells/s", "GB/s", "of peak" );
+
+	FILE *file = NULL;
+	if ( csv not_eq NULL )
+	{
+		file = fopen( csv, "w" );
+		if ( file eqt NULL ) printf( "open %s failed\n", csv );
+		else fprintf( file, "kernel,n,scalar,threads,simd,ms,mcells_s,gb_s,stream_gb_s\n" );
+	}
+
+	for ( size_t k = 0; k < kernels.size(); k++ )
+	for ( size_t g = 0; g < grids.size(); g++ )
+	for ( size_t s = 0; s < scalars.size(); s++ )
+	{
+		cint kernel = kernels[k], n = grids[g];
+		const SCALAR scalar = scalars[s];
+		const size_t bytes = ( scalar eqt SCALAR_FLOAT ) ? sizeof(float) : sizeof(double);
+		const char *name = ( scalar eqt SCALAR_FLOAT ) ? "float" : "double";
+
+		/* the fields, and the upsampled grid of upscaling */
+		GridLayout grid( n, n, n, GRIDS_HALO );
+		double needed = (double)grid.Elements() * bytes * ( t_fields[kernel] + ( kernel eqt KERNEL_UPSCALING ? UPSCALED_FIELDS : 0 ) ) / 1048576.0;
+
+		if ( needed > budget )
+		{
+			printf( "%-10s %6d %-7s %12s, needs %.0f MB\n", t_kernelname[kernel], n, name, "skipped", needed );
+			continue;
+		}
+
+		double seconds = ( scalar eqt SCALAR_FLOAT ) ?
+			Measure<float>( kernel, n, pool, simd, depth, least ) : Measure<double>( kernel, n, pool, simd, depth, least );
+
+		if ( seconds <= 0.f )
+		{
+			printf( "%-10s %6d %-7s %12s\n", t_kernelname[kernel], n, name, "failed" );
+			continue;
+		}
+
+		/* the volume writes a byte per cell besides reading the density */
+		double cells = (double)n * n * n;
+		double traffic = cells * ( t_traffic[kernel] * bytes + ( kernel eqt KERNEL_VOLUME ? 1 : 0 ) );
+		double gbs = traffic / seconds / 1e9;
+
+		printf( "%-10s %6d %-7s %12.3f %12.1f %10.2f %8.1f%%\n", t_kernelname[kernel], n, name, seconds * 1000.0,
+			cells / seconds / 1e6, gbs, 100.0 * gbs / ceiling );
+
+		if ( file not_eq NULL )
+			fprintf( file, "%s,%d,%s,%d,%d,%.6f,%.3f,%.3f,%.3f\n", t_kernelname[kernel], n, name, pool.Threads(), (int)simd,
+				seconds * 1000.0, cells / seconds / 1e6, gbs, ceiling );
+	}
+
+	if ( file not_eq NULL ) fclose( file );
+
+	return 0;
+};
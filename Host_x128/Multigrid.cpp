@@ -0,0 +1,306 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Multigrid.cpp
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "Multigrid.h"
+#include "Kernels.h"
+
+using namespace sge;
+
+/* the fine level gets the layouts of the fields, the coarse ones are small enough for GridLayout */
+#define LEVEL_CALL( level, call ) \
+	if ( (level) eqt 0 ) { DISPATCH_LAYOUT( m_levels[0].grid, call ); } \
+	else { const GridLayout &lay = m_levels[level].grid; call; }
+
+
+/* red-black Gauss-Seidel sweeps of 6 x - sum( neighbours ) = b */
+template <class L, typename T>
+static void kernelSmooth( const L &lay, ThreadPool &pool, T *x, const T *b, cint sweeps )
+{
+	for ( int n = 0; n < sweeps; n++ ) for ( int color = 0; color < 2; color++ )
+	{
+		pool.ParallelFor( 1, lay.Z() - 1, [&]( int k0, int k1 )
+		{
+			for ( int k = k0; k < k1; k++ ) for ( int j = 1; j < lay.Y() - 1; j++ )
+				atomicJacobiRow( lay, x, x, b, (T)1.0, (T)6.0, j, k, 1 + ( ( 1 + j + k + color ) & 1 ), 2 );
+		} );
+	}
+};
+
+
+/* r = b - Ax on the interior, partial[k] takes the squared residual of slab k, *
+ * r may be NULL if only the norm is wanted                                     */
+template <class L, typename T>
+static void kernelResidual
+	( const L &lay, ThreadPool &pool, T *r, const T *x, const T *b, double *partial )
+{
+	pool.ParallelFor( 1, lay.Z() - 1, [&]( int k0, int k1 )
+	{
+		for ( int k = k0; k < k1; k++ )
+		{
+			double sum = 0.f;
+			for ( int j = 1; j < lay.Y() - 1; j++ ) for ( int i = 1; i < lay.X() - 1; i++ )
+			{
+				T res = b[lay.ix(i,j,k)] - ( 6.f * x[lay.ix(i,j,k)] - (
+					x[lay.ix(i-1,j,k)] + x[lay.ix(i+1,j,k)] +
+					x[lay.ix(i,j-1,k)] + x[lay.ix(i,j+1,k)] +
+					x[lay.ix(i,j,k-1)] + x[lay.ix(i,j,k+1)] ) );
+
+				if ( r not_eq NULL ) r[lay.ix(i,j,k)] = res;
+				sum += (double)res * res;
+			}
+			partial[k] = sum;
+		}
+	} );
+};
+
+
+/* squared interior values of field, one partial sum per slab */
+template <class L, typename T>
+static void kernelSquares( const L &lay, ThreadPool &pool, const T *field, double *partial )
+{
+	pool.ParallelFor( 1, lay.Z() - 1, [&]( int k0, int k1 )
+	{
+		for ( int k = k0; k < k1; k++ )
+		{
+			double sum = 0.f;
+			for ( int j = 1; j < lay.Y() - 1; j++ ) for ( int i = 1; i < lay.X() - 1; i++ )
+				sum += (double)field[lay.ix(i,j,k)] * field[lay.ix(i,j,k)];
+			partial[k] = sum;
+		}
+	} );
+};
+
+
+/* full weighting of the fine residual onto the coarse right hand side, coarse node I *
+ * sits on fine node 2I, the factor 4 accounts for the doubled spacing                */
+template <class L, typename T>
+static void kernelRestrict
+	( const L &fine, const GridLayout &coarse, ThreadPool &pool, T *bc, const T *rf )
+{
+	pool.ParallelFor( 1, coarse.nz - 1, [&]( int k0, int k1 )
+	{
+		for ( int K = k0; K < k1; K++ ) for ( int J = 1; J < coarse.ny - 1; J++ ) for ( int I = 1; I < coarse.nx - 1; I++ )
+		{
+			T sum = 0.f;
+			for ( int dk = -1; dk <= 1; dk++ ) for ( int dj = -1; dj <= 1; dj++ ) for ( int di = -1; di <= 1; di++ )
+			{
+				T weight = ( dk ? 0.25f : 0.5f ) * ( dj ? 0.25f : 0.5f ) * ( di ? 0.25f : 0.5f );
+				sum += weight * rf[fine.ix( 2*I + di, 2*J + dj, 2*K + dk )];
+			}
+			bc[coarse.ix(I, J, K)] = 4.f * sum;
+		}
+	} );
+};
+
+
+/* add the trilinear interpolation of the coarse correction to the fine grid, a fine *
+ * node between two coarse nodes takes half of each, one on a coarse node takes it   */
+template <class L, typename T>
+static void kernelProlong
+	( const GridLayout &coarse, const L &fine, ThreadPool &pool, T *xf, const T *xc )
+{
+	pool.ParallelFor( 1, fine.Z() - 1, [&]( int k0, int k1 )
+	{
+		for ( int k = k0; k < k1; k++ ) for ( int j = 1; j < fine.Y() - 1; j++ ) for ( int i = 1; i < fine.X() - 1; i++ )
+		{
+			cint i0 = i >> 1, i1 = ( i + 1 ) >> 1;
+			cint j0 = j >> 1, j1 = ( j + 1 ) >> 1;
+			cint k0c = k >> 1, k1c = ( k + 1 ) >> 1;
+
+			xf[fine.ix(i,j,k)] += 0.125f * (
+				xc[coarse.ix(i0,j0,k0c)] + xc[coarse.ix(i1,j0,k0c)] +
+				xc[coarse.ix(i0,j1,k0c)] + xc[coarse.ix(i1,j1,k0c)] +
+				xc[coarse.ix(i0,j0,k1c)] + xc[coarse.ix(i1,j0,k1c)] +
+				xc[coarse.ix(i0,j1,k1c)] + xc[coarse.ix(i1,j1,k1c)] );
+		}
+	} );
+};
+
+
+template <typename T>
+Multigrid<T>::Multigrid( void ) : m_presmooth(2), m_postsmooth(2), m_coarsesweeps(32) {};
+
+
+template <typename T>
+Multigrid<T>::~Multigrid( void )
+{
+	Release();
+};
+
+
+template <typename T>
+void Multigrid<T>::Release( void )
+{
+	for ( size_t l = 0; l < m_levels.size(); l++ )
+	{
+		/* x and b of the fine level belong to the caller */
+		if ( l > 0 )
+		{
+			free( m_levels[l].x );
+			free( m_levels[l].b );
+		}
+		free( m_levels[l].r );
+	}
+	m_levels.clear();
+};
+
+
+template <typename T>
+void Multigrid<T>::Build( const GridLayout &fine )
+{
+	Release();
+
+	LEVEL level;
+	level.grid = fine;
+	level.x = level.b = NULL;
+	level.r = (T*) calloc( fine.Elements(), sizeof(T) );
+	m_levels.push_back( level );
+
+	/* halve the interior of every axis until one of them gets too thin */
+	while ( true )
+	{
+		const GridLayout &prev = m_levels.back().grid;
+		int nx = ( prev.nx - 2 ) / 2;
+		int ny = ( prev.ny - 2 ) / 2;
+		int nz = ( prev.nz - 2 ) / 2;
+		if ( nx < 2 or ny < 2 or nz < 2 ) break;
+
+		level.grid = GridLayout( nx + 2, ny + 2, nz + 2 );
+		level.x = (T*) calloc( level.grid.Elements(), sizeof(T) );
+		level.b = (T*) calloc( level.grid.Elements(), sizeof(T) );
+		level.r = (T*) calloc( level.grid.Elements(), sizeof(T) );
+		m_levels.push_back( level );
+	}
+
+	m_partial.assign( fine.nz, 0.f );
+};
+
+
+template <typename T>
+double Multigrid<T>::Norm( ThreadPool &pool, cint level, const T *field )
+{
+	LEVEL_CALL( level, kernelSquares( lay, pool, field, &m_partial[0] ) );
+
+	return sqrt( atomicReduceTree( REDUCE_SUM, &m_partial[1], m_levels[level].grid.nz - 2 ) );
+};
+
+
+template <typename T>
+double Multigrid<T>::ResidualNorm( ThreadPool &pool, cint level )
+{
+	LEVEL &lv = m_levels[level];
+	LEVEL_CALL( level, kernelResidual( lay, pool, lv.r, lv.x, lv.b, &m_partial[0] ) );
+
+	return sqrt( atomicReduceTree( REDUCE_SUM, &m_partial[1], lv.grid.nz - 2 ) );
+};
+
+
+template <typename T>
+void Multigrid<T>::VCycle( ThreadPool &pool, cint level )
+{
+	LEVEL &lv = m_levels[level];
+
+	/* the coarsest level is small enough to be smoothed to convergence */
+	if ( level eqt Levels() - 1 )
+	{
+		LEVEL_CALL( level, kernelSmooth( lay, pool, lv.x, lv.b, m_coarsesweeps ) );
+		return;
+	}
+
+	LEVEL &next = m_levels[level + 1];
+
+	LEVEL_CALL( level, kernelSmooth( lay, pool, lv.x, lv.b, m_presmooth ) );
+	LEVEL_CALL( level, kernelResidual( lay, pool, lv.r, lv.x, lv.b, &m_partial[0] ) );
+
+	LEVEL_CALL( level, kernelRestrict( lay, next.grid, pool, next.b, lv.r ) );
+	memset( next.x, 0, next.grid.Elements() * sizeof(T) );
+
+	VCycle( pool, level + 1 );
+
+	LEVEL_CALL( level, kernelProlong( next.grid, lay, pool, lv.x, next.x ) );
+	LEVEL_CALL( level, kernelSmooth( lay, pool, lv.x, lv.b, m_postsmooth ) );
+};
+
+
+template <typename T>
+void Multigrid<T>::FullMultigrid( ThreadPool &pool )
+{
+	/* carry the right hand side down to the coarsest level */
+	for ( int l = 0; l < Levels() - 1; l++ )
+		LEVEL_CALL( l, kernelRestrict( lay, m_levels[l + 1].grid, pool, m_levels[l + 1].b, m_levels[l].b ) );
+
+	/* solve there, then interpolate the solution up and refine it level by level */
+	for ( int l = Levels() - 1; l >= 0; l-- )
+	{
+		memset( m_levels[l].x, 0, m_levels[l].grid.Elements() * sizeof(T) );
+		if ( l < Levels() - 1 )
+		{
+			LEVEL_CALL( l, kernelProlong( m_levels[l + 1].grid, lay, pool, m_levels[l].x, m_levels[l + 1].x ) );
+		}
+
+		VCycle( pool, l );
+	}
+};
+
+
+template <typename T>
+int Multigrid<T>::Solve( ThreadPool &pool, T *x, const T *b, cdouble tol, cint maxcycles,
+	const bool fmg, double *residual )
+{
+	m_levels[0].x = x;
+	m_levels[0].b = (T*)b;
+
+	int cycles = 0;
+	double bnorm = Norm( pool, 0, b );
+
+	/* no divergence, nothing to correct */
+	if ( bnorm <= 0.f )
+	{
+		if ( residual not_eq NULL ) *residual = 0.f;
+		m_levels[0].x = m_levels[0].b = NULL;
+		return 0;
+	}
+
+	if ( fmg )
+	{
+		FullMultigrid( pool );
+		cycles++;
+	}
+
+	double rel = ResidualNorm( pool, 0 ) / bnorm;
+	while ( rel > tol and cycles < maxcycles )
+	{
+		VCycle( pool, 0 );
+		cycles++;
+		rel = ResidualNorm( pool, 0 ) / bnorm;
+	}
+
+	if ( residual not_eq NULL ) *residual = rel;
+	m_levels[0].x = m_levels[0].b = NULL;
+	return cycles;
+};
+
+
+template <typename T>
+double Multigrid<T>::Residual( ThreadPool &pool, const T *x, const T *b )
+{
+	double bnorm = Norm( pool, 0, b );
+	if ( bnorm <= 0.f ) return 0.f;
+
+	LEVEL_CALL( 0, kernelResidual( lay, pool, (T*)NULL, x, b, &m_partial[0] ) );
+
+	return sqrt( atomicReduceTree( REDUCE_SUM, &m_partial[1], m_levels[0].grid.nz - 2 ) ) / bnorm;
+};
+
+
+/* the storage precisions of FluidSimProc */
+template class sge::Multigrid<float>;
+template class sge::Multigrid<double>;
@@ -0,0 +1,80 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Multigrid.h
+*/
+
+#ifndef __multigrid_h_
+#define __multigrid_h_
+
+#include <vector>
+#include "GridLayout.h"
+#include "ThreadPool.h"
+#include "ISO646.h"
+
+namespace sge
+{
+	/* how Projection solves the pressure equation */
+	enum PRESSURESOLVER
+	{
+		PRESSURE_JACOBI = 0, // 10 relaxation sweeps, the original scheme
+		PRESSURE_VCYCLE = 1, // multigrid V-cycles until the residual drops below the tolerance
+		PRESSURE_FMG    = 2, // full multigrid start, then V-cycles as above
+	};
+
+
+	/* geometric multigrid for 6 x - ( sum of the six neighbours of x ) = b on the  *
+	 * interior of a grid, the boundary cells of x are held at zero, every level is *
+	 * stored in T while the norms are summed in double                             */
+	template <typename T>
+	class Multigrid
+	{
+	private:
+		struct LEVEL
+		{
+			GridLayout grid;
+			T *x, *b, *r;
+		};
+
+		std::vector<LEVEL> m_levels;
+
+		/* one partial sum per slab, combined by atomicReduceTree to stay deterministic */
+		std::vector<double> m_partial;
+
+		int m_presmooth, m_postsmooth, m_coarsesweeps;
+
+	public:
+		Multigrid( void );
+
+		~Multigrid( void );
+
+	public:
+		/* create the coarse levels below the fine grid */
+		void Build( const GridLayout &fine );
+
+		int Levels( void ) const { return (int)m_levels.size(); };
+
+		/* improve x until |b - Ax| <= tol * |b| or maxcycles V-cycles are done, *
+		 * returns the V-cycles spent, and the relative residual in *residual     */
+		int Solve( ThreadPool &pool, T *x, const T *b, cdouble tol, cint maxcycles,
+			const bool fmg, double *residual );
+
+		/* |b - Ax| / |b| of a fine grid solution */
+		double Residual( ThreadPool &pool, const T *x, const T *b );
+
+	private:
+		void Release( void );
+
+		void VCycle( ThreadPool &pool, cint level );
+
+		void FullMultigrid( ThreadPool &pool );
+
+		double ResidualNorm( ThreadPool &pool, cint level );
+
+		double Norm( ThreadPool &pool, cint level, const T *field );
+	};
+};
+
+#endif
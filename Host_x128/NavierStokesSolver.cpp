@@ -1,4 +1,4 @@
-/**
+﻿/**
 * <Author>        Orlando Chen
 * <Email>         seagochen@gmail.com
 * <First Time>    Dec 15, 2013
@@ -6,88 +6,70 @@
 * <File Name>     NavierStokesSolver.cpp
 */
 
+#include <stdio.h>
+#include <stdlib.h>
 #include "MacroDefinition.h"
 #include "FluidSimProc.h"
 #include "MacroDefinition.h"
+#include "Kernels.h"
+#include "FloatControl.h"
+#include "StopWatch.h"
+#include "Trace.h"
 #include "ISO646.h"
 
 
 using namespace sge;
 
-int IX( int i, int j, int k, int tx, int ty ) { return k * tx * ty + j * tx + i; };
-
-double atomicGetValue
-	( cdouble *grid, cint x, cint y, cint z, cint tx, cint ty, cint tz )
+template <typename T>
+void FluidSimProc::Advection( const GridLayout &grid, T *out, const T *in, const T *u, const T *v, const T *w, cdouble dt )
 {
-	if ( x < 0 or x >= tx ) return 0.f;
-	if ( y < 0 or y >= ty ) return 0.f;
-	if ( z < 0 or z >= tz ) return 0.f;
+	TraceScope trace( "advection" );
+	PerfScope perf( m_perf, m_perfstage[PERF_ADVECTION], &grid eqt &m_grid );
 
-	return grid[ IX( x, y, z, tx, ty ) ];
-};
+	const STENCILROWS<T> *rows = StencilRows<T>( m_simd );
 
-double atomicTrilinear
-	( cdouble *grid, cdouble x, cdouble y, cdouble z, cint tx, cint ty, cint tz )
-{
-	int i = (int)x;
-	int j = (int)y;
-	int k = (int)z;
-
-	double v000 = atomicGetValue( grid, i, j, k, tx, ty, tz );
-	double v001 = atomicGetValue( grid, i, j+1, k, tx, ty, tz );
-	double v011 = atomicGetValue( grid, i, j+1, k+1, tx, ty, tz );
-	double v010 = atomicGetValue( grid, i, j, k+1, tx, ty, tz );
-	double v100 = atomicGetValue( grid, i+1, j, k, tx, ty, tz );
-	double v101 = atomicGetValue( grid, i+1, j+1, k, tx, ty, tz );
-	double v111 = atomicGetValue( grid, i+1, j+1, k+1, tx, ty, tz );
-	double v110 = atomicGetValue( grid, i+1, j, k+1, tx, ty, tz );
-
-	double dx = x - (int)(x);
-	double dy = y - (int)(y);
-	double dz = z - (int)(z);
-
-	double c00 = v000 * ( 1 - dx ) + v001 * dx;
-	double c10 = v010 * ( 1 - dx ) + v011 * dx;
-	double c01 = v100 * ( 1 - dx ) + v101 * dx;
-	double c11 = v110 * ( 1 - dx ) + v111 * dx;
-
-	double c0 = c00 * ( 1 - dy ) + c10 * dy;
-	double c1 = c01 * ( 1 - dy ) + c11 * dy;
-
-	double c = c0 * ( 1 - dz ) + c1 * dz;
-
-	return c;
+	if ( rows not_eq NULL )
+		kernelAdvection( grid, *rows, out, in, u, v, w, dt );
+	else
+		DISPATCH_LAYOUT( grid, kernelAdvection( lay, out, in, u, v, w, dt ) );
 };
 
 
-void FluidSimProc::Advection( double *out, cdouble *in, cdouble *u, cdouble *v, cdouble *w, cdouble dt )
+template <typename T>
+void FluidSimProc::VectorAdvection( const GridLayout &grid,
+	T *outu, T *outv, T *outw, const T *u, const T *v, const T *w, cdouble dt )
 {
-	for ( int k = 1; k < 127; k++ ) for ( int j = 1; j < 127; j++ ) for ( int i = 1; i < 127; i++ )
-	{
-		double velu = i - u[ ix(i,j,k) ] * dt;
-		double velv = j - v[ ix(i,j,k) ] * dt;
-		double velw = k - w[ ix(i,j,k) ] * dt;
+	TraceScope trace( "advection" );
+	PerfScope perf( m_perf, m_perfstage[PERF_ADVECTION], &grid eqt &m_grid );
 
-		out[ ix(i,j,k) ] = atomicTrilinear( in, velu, velv, velw, 128, 128, 128 );
-	}
+	const STENCILROWS<T> *rows = StencilRows<T>( m_simd );
+
+	if ( rows not_eq NULL )
+		kernelVectorAdvection( grid, *rows, outu, outv, outw, u, v, w, dt );
+	else
+		DISPATCH_LAYOUT( grid, kernelVectorAdvection( lay, outu, outv, outw, u, v, w, dt ) );
 };
 
 
-void FluidSimProc::Jacobi(double *out, cdouble *in, cdouble diff, cdouble divisor)
+template <typename T>
+void FluidSimProc::Jacobi( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f,
+	T *out, const T *in, cdouble diff, cdouble divisor )
 {
-	double dix = ( divisor > 0 ) ? divisor : 1.f;
+	const STENCILROWS<T> *rows = StencilRows<T>( m_simd );
 
-    for(int n=0; n<10; n++)
-    {
-		for ( int k = 1; k < 127; k++ ) for ( int j = 1; j < 127; j++ ) for ( int i = 1; i < 127; i++ )
-		{
-			out[ix(i, j, k)] = (
-				in[ix(i, j, k)] + diff * (
-				out[ix(i-1, j, k)] + out[ix(i+1, j, k)] + 
-				out[ix(i, j-1, k)] + out[ix(i, j+1, k)] + 
-				out[ix(i, j, k-1)] + out[ix(i, j, k+1)] 	)) / dix;
-		}
-    }
+	if ( m_depth > 0 )
+	{
+		DISPATCH_LAYOUT( grid,
+			kernelJacobiBlocked( lay, pool, m_relax, rows, out, in, f.tmp, diff, divisor, m_depth ) );
+	}
+	elif ( rows not_eq NULL and m_relax not_eq RELAX_GAUSS_SEIDEL )
+	{
+		kernelJacobi( grid, pool, m_relax, *rows, out, in, f.tmp, diff, divisor );
+	}
+	else
+	{
+		DISPATCH_LAYOUT( grid, kernelJacobi( lay, pool, m_relax, out, in, f.tmp, diff, divisor ) );
+	}
 }
 
 
@@ -147,129 +129,235 @@ void FluidSimProc::Diffusion( double *out, cdouble *in, cdouble diff )
 };
 #endif
 
-void FluidSimProc::Diffusion( double *out, cdouble *in, cdouble diff )
+template <typename T>
+void FluidSimProc::Diffusion( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f,
+	T *out, const T *in, cdouble diff )
 {
-    double alpha = DELTATIME * diff * 128 * 128 * 128;
+	TraceScope trace( "diffusion" );
+	PerfScope perf( m_perf, m_perfstage[PERF_DIFFUSION], &grid eqt &m_grid );
 
-    Jacobi( out, in, alpha, 1 + 6 * alpha );
+    double alpha = DELTATIME * diff * grid.nx * grid.ny * grid.nz;
+
+    Jacobi( grid, pool, f, out, in, alpha, 1 + 6 * alpha );
 }
 
 
-void kernelGradient( double *div, double *prs, cdouble *u, cdouble *v, cdouble *w )
+template <typename T>
+void FluidSimProc::Projection( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f,
+	T *u, T *v, T *w, T *div, T *p )
 {
-	for ( int k = 1; k < 127; k++ ) for ( int j = 1; j < 127; j++ ) for ( int i = 1; i < 127; i++ )
+	TraceScope trace( "projection" );
+
+	const STENCILROWS<T> *rows = StencilRows<T>( m_simd );
+
+	/* the subnodes are solved side by side and keep no statistics */
+	const bool global = ( &grid eqt &m_grid );
+	PerfScope perf( m_perf, m_perfstage[PERF_PROJECTION], global );
+	double residual;
+
+	StopWatch watch;
+
+	// the velocity gradient
+	if ( rows not_eq NULL )
+		kernelGradient( grid, *rows, div, p, u, v, w );
+	else
+		DISPATCH_LAYOUT( grid, kernelGradient( lay, div, p, u, v, w ) );
+
+	if ( m_pressure eqt PRESSURE_JACOBI )
 	{
-		cdouble hx = 1.f / (double)128;
-		cdouble hy = 1.f / (double)128;
-		cdouble hz = 1.f / (double)128;
-
-		// previous instantaneous magnitude of velocity gradient 
-		//		= (sum of velocity gradients per axis)/2N:
-//		div[ IX(i,j,k,128,128) ] = -0.5f * (
-//			hx * ( u[ IX(i+1,j,k,128,128) ] - u[ IX(i-1,j,k,128,128) ] ) +
-//			hy * ( v[ IX(i,j+1,k,128,128) ] - v[ IX(i,j-1,k,128,128) ] ) +
-//			hz * ( w[ IX(i,j,k+1,128,128) ] - w[ IX(i,j,k-1,128,128) ] ) );
-		
-		div[ IX(i,j,k,128,128) ] = (double) ( -1.f / 3.f * ( 
-			( u[ IX(i+1,j,k,128,128) ] - u[ IX(i-1,j,k,128,128) ] ) / 128.f + 
-			( v[ IX(i,j+1,k,128,128) ] - v[ IX(i,j-1,k,128,128) ] ) / 128.f + 
-			( w[ IX(i,j,k+1,128,128) ] - w[ IX(i,j,k-1,128,128) ] ) / 128.f ));
-
-		// zero out the present velocity gradient
-		prs[ IX(i,j,k,128,128) ] = 0.f;
+		// reuse the Gauss-Seidel relaxation solver to safely diffuse the velocity gradients from p to div
+		Jacobi( grid, pool, f, p, div, 1.f, 6.f );
+
+		// how far from the solution the sweeps stopped, to compare with multigrid, when asked
+		if ( m_jacobiresidual and global and grid.storage not_eq STORAGE_SPARSE )
+			m_residual = f.multigrid.Residual( pool, p, div );
+	}
+	else
+	{
+		// or solve the Poisson equation by multigrid, down to the requested residual
+		int cycles = f.multigrid.Solve( pool, p, div, m_tolerance, m_maxcycles,
+			m_pressure eqt PRESSURE_FMG, &residual );
+
+		if ( global ) { m_cycles += cycles; m_residual = residual; }
 	}
+
+	// now subtract this gradient from our current velocity field
+	if ( rows not_eq NULL )
+		kernelSubtract( grid, *rows, u, v, w, p );
+	else
+		DISPATCH_LAYOUT( grid, kernelSubtract( lay, u, v, w, p ) );
+
+	if ( global ) m_projtime += watch.Elapsed();
 };
 
+void FluidSimProc::SourceSolver( cdouble dt )
+{
+	TraceScope trace( "source", m_steps );
+	LatencyScope latency( m_latency[LATENCY_SOURCE] );
+	PerfScope perf( m_perf, m_perfstage[PERF_SOURCE] );
 
-void kernelSubtract( double *u, double *v, double *w, double *prs )
+	/* the bricks of a sparse grid follow the smoke once a step */
+	if ( m_grid.storage eqt STORAGE_SPARSE ) UpdateBricks();
+
+	DISPATCH_FIELDS( DISPATCH_LAYOUT( m_grid, SourceSolver( lay, fields, dt ) ) );
+};
+
+void FluidSimProc::DensitySolver( cdouble dt )
 {
-	for ( int k = 1; k < 127; k++ ) for ( int j = 1; j < 127; j++ ) for ( int i = 1; i < 127; i++ )
-	{
-//		u[ IX(i,j,k,128,128) ] -= 0.5f * 128 * ( prs[ IX(i+1,j,k,128,128) ] - prs[ IX(i-1,j,k,128,128) ] );
-//		v[ IX(i,j,k,128,128) ] -= 0.5f * 128 * ( prs[ IX(i,j+1,k,128,128) ] - prs[ IX(i,j-1,k,128,128) ] );
-//		w[ IX(i,j,k,128,128) ] -= 0.5f * 128 * ( prs[ IX(i,j,k+1,128,128) ] - prs[ IX(i,j,k-1,128,128) ] );
+	TraceScope trace( "density", m_steps );
+	LatencyScope latency( m_latency[LATENCY_DENSITY] );
 
-        u[ IX(i,j,k,128,128) ] -= 0.5f * 128.f * ( prs[ IX(i+1,j,k,128,128) ] - prs[ IX(i-1,j,k,128,128) ] );
-        v[ IX(i,j,k,128,128) ] -= 0.5f * 128.f * ( prs[ IX(i,j+1,k,128,128) ] - prs[ IX(i,j-1,k,128,128) ] );
-        w[ IX(i,j,k,128,128) ] -= 0.5f * 128.f * ( prs[ IX(i,j,k+1,128,128) ] - prs[ IX(i,j,k-1,128,128) ] );
+	DenormalsToZero ftz( m_scalar eqt SCALAR_FLOAT );
+	DISPATCH_FIELDS( DensitySolver( m_grid, m_pool, fields, dt ) );
 
-	} 
+	/* the last stage of a step of the grid */
+	m_steps++;
 };
 
-void FluidSimProc::Projection( double *u, double *v, double *w, double *div, double *p )
+void FluidSimProc::VelocitySolver( cdouble dt )
 {
-	// the velocity gradient
-	kernelGradient( div, p, u, v, w );
+	TraceScope trace( "velocity", m_steps );
+	LatencyScope latency( m_latency[LATENCY_VELOCITY] );
+
+	/* the double fields keep the exact arithmetic of the reference */
+	DenormalsToZero ftz( m_scalar eqt SCALAR_FLOAT );
+	DISPATCH_FIELDS( VelocitySolver( m_grid, m_pool, fields, dt ) );
+};
 
-	// reuse the Gauss-Seidel relaxation solver to safely diffuse the velocity gradients from p to div
-	Jacobi( p, div, 1.f, 6.f );
+template <typename T>
+void FluidSimProc::UpdateBricks( FIELDS<T> &f )
+{
+	/* density and velocity decide, the other fields follow */
+	T *fields[] = { f.den, f.u, f.v, f.w, f.den0, f.u0, f.v0, f.w0, f.p, f.obs, f.div, f.tmp };
 
-	// now subtract this gradient from our current velocity field
-	kernelSubtract ( u, v, w, p );
+	bool grown = m_grid.map->Update( fields, 12, 4, (T)SPARSE_EPSILON );
+
+	f.den = fields[0]; f.u  = fields[1]; f.v  = fields[2]; f.w  = fields[3];
+	f.den0 = fields[4]; f.u0 = fields[5]; f.v0 = fields[6]; f.w0 = fields[7];
+	f.p = fields[8]; f.obs = fields[9]; f.div = fields[10]; f.tmp = fields[11];
+
+	if ( not grown )
+	{
+		printf( "grow sparse buffers for host failed\n" );
+		FreeResource();
+		exit(1);
+	}
 };
 
-static int times = 0;
+void FluidSimProc::UpdateBricks( void )
+{
+	DISPATCH_FIELDS( UpdateBricks( fields ) );
+};
 
-void FluidSimProc::SourceSolver( cdouble dt )
+void FluidSimProc::SolveNodeFlux( void )
+{
+	TraceScope trace( "nodes", m_steps - 1 );
+	LatencyScope latency( m_latency[LATENCY_NODES] );
+
+	if ( m_sync eqt NODES_EXCHANGE ) SyncNodes(); else InterpolationData();
+
+	DenormalsToZero ftz( m_scalar eqt SCALAR_FLOAT );
+	DISPATCH_NODES( SolveNodeFlux( nodes ) );
+
+	if ( m_sync eqt NODES_EXCHANGE ) ExchangeHalos();
+
+	if ( m_restrict ) RestrictNodes();
+};
+
+template <typename T>
+void FluidSimProc::SolveNodeFlux( vector< FIELDS<T> > &nodes )
 {
-	double rate = (double)(rand() % 300 + 1) / 100.f;
+	/* the subnodes holding enough smoke, a negative gate takes them all */
+	vector<int> solve;
+	for ( int n = 0; n < (int)nodes.size(); n++ )
+		if ( IsGated( n ) ) solve.push_back( n );
+
+	StopWatch watch;
+
+	/* a task per subnode, their stencils split into tasks again, so the threads   *
+	 * left idle by a few subnodes steal sweeps of the others; the source only      *
+	 * feeds the global grid, the subnodes keeping their state take its cells from *
+	 * there in SyncNodes                                                           */
+	TaskGroup group;
 
-	for ( int k = 0; k < 128; k++ ) for ( int j = 0; j < 128; j++ ) for ( int i = 0; i < 128; i++ )
+	for ( size_t n = 0; n < solve.size(); n++ )
 	{
-		if ( obs[ix(i,j,k)] < 0.f )
+		FIELDS<T> &node = nodes[ solve[n] ];
+
+		m_pool.Spawn( group, [this, &node]( void )
 		{
-//			double pop = -obs[ix(i,j,k)] / 100.f;
+			VelocitySolver( m_node, m_pool, node, DELTATIME );
+			DensitySolver( m_node, m_pool, node, DELTATIME );
+		} );
+	}
+
+	m_pool.Wait( group );
+
+	for ( int n = 0; n < (int)nodes.size(); n++ ) m_active[n] = IsGated( n );
+
+	m_solved   = (int)solve.size();
+	m_nodetime = watch.Elapsed();
+};
+
+template <class L, typename T>
+void FluidSimProc::SourceSolver( const L &lay, FIELDS<T> &f, cdouble dt )
+{
+	atomicCells( lay, [&]( int i, int j, int k )
+	{
+		if ( f.obs[lay.ix(i,j,k)] < 0.f )
+		{
+//			double pop = -obs[lay.ix(i,j,k)] / 100.f;
 
 			/* add source to grids */
-//			if ( times < 20 )
+//			if ( m_times < 20 )
 //			{
-//				//den[ix(i,j,k)] = DENSITY * rate * dt * pop;
+//				//den[lay.ix(i,j,k)] = DENSITY * rate * dt * pop;
 //				
-//				times++;
+//				m_times++;
 //			}
 
-			if ( times < 10 )
-			//v[ix(i,j,k)] = VELOCITY * rate * dt * pop;
+			if ( m_times < 10 )
+			//v[lay.ix(i,j,k)] = VELOCITY * rate * dt * pop;
 			{
-				den[ ix(i,j,k) ] = DENSITY * dt;
-				times++;
+				f.den[ lay.ix(i,j,k) ] = DENSITY * dt;
+				m_times++;
 			}
 
-			v[ix(i,j,k)] = VELOCITY * dt;
+			f.v[lay.ix(i,j,k)] = VELOCITY * dt;
 		}
-	}
+	} );
 };
 
-void FluidSimProc::DensitySolver( cdouble dt )
+template <typename T>
+void FluidSimProc::DensitySolver( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f, cdouble dt )
 {
-	Diffusion( den0, den, DIFFUSION );
-	std::swap( den0, den );
-	Advection( den, den0, u, v, w, dt );
+	Diffusion( grid, pool, f, f.den0, f.den, DIFFUSION );
+	std::swap( f.den0, f.den );
+	Advection( grid, f.den, f.den0, f.u, f.v, f.w, dt );
 };
 
-void FluidSimProc::VelocitySolver( cdouble dt )
+template <typename T>
+void FluidSimProc::VelocitySolver( const GridLayout &grid, ThreadPool &pool, FIELDS<T> &f, cdouble dt )
 {
 	// diffuse the velocity field (per axis):
-	Diffusion( u0, u, VISOCITY );
-	Diffusion( v0, v, VISOCITY );
-	Diffusion( w0, w, VISOCITY );
+	Diffusion( grid, pool, f, f.u0, f.u, VISOCITY );
+	Diffusion( grid, pool, f, f.v0, f.v, VISOCITY );
+	Diffusion( grid, pool, f, f.w0, f.w, VISOCITY );
 
-	std::swap( u0, u );
-	std::swap( v0, v );
-	std::swap( w0, w );
+	std::swap( f.u0, f.u );
+	std::swap( f.v0, f.v );
+	std::swap( f.w0, f.w );
 
 	// stabilize it: (vx0, vy0 are whatever, being used as temporaries to store gradient field)
-	Projection( u, v, w, div, p );
+	Projection( grid, pool, f, f.u, f.v, f.w, f.div, f.p );
 	
-	// advect the velocity field (per axis):
-	Advection( u0, u, u, v, w, dt );
-	Advection( v0, v, u, v, w, dt );
-	Advection( w0, w, u, v, w, dt );
-
-	std::swap( u0, u );
-	std::swap( v0, v );
-	std::swap( w0, w );
+	// advect the velocity field by itself, all axes in one pass:
+	VectorAdvection( grid, f.u0, f.v0, f.w0, f.u, f.v, f.w, dt );
+
+	std::swap( f.u0, f.u );
+	std::swap( f.v0, f.v );
+	std::swap( f.w0, f.w );
 	
 	// stabilize it: (vx0, vy0 are whatever, being used as temporaries to store gradient field)
-	Projection( u, v, w, div, p );
+	Projection( grid, pool, f, f.u, f.v, f.w, f.div, f.p );
 };
\ No newline at end of file
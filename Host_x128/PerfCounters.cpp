@@ -0,0 +1,166 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     PerfCounters.cpp
+*/
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include "PerfCounters.h"
+
+using namespace sge;
+
+
+#if defined(__linux__)
+/* the type and config of each PERFCOUNTER */
+static void Event( cint counter, unsigned int &type, unsigned long long &config )
+{
+	switch ( counter )
+	{
+	case PERF_CYCLES:
+		type = PERF_TYPE_HARDWARE; config = PERF_COUNT_HW_CPU_CYCLES;
+		break;
+
+	case PERF_INSTRUCTIONS:
+		type = PERF_TYPE_HARDWARE; config = PERF_COUNT_HW_INSTRUCTIONS;
+		break;
+
+	case PERF_LLC_MISSES:
+		type = PERF_TYPE_HW_CACHE;
+		config = PERF_COUNT_HW_CACHE_LL | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+		break;
+
+	default:
+		type = PERF_TYPE_HW_CACHE;
+		config = PERF_COUNT_HW_CACHE_DTLB | ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) | ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 );
+		break;
+	}
+};
+
+
+/* the threads of this process */
+static std::vector<int> Threads( void )
+{
+	std::vector<int> tids;
+
+	DIR *dir = opendir( "/proc/self/task" );
+	if ( dir eqt NULL )
+	{
+		tids.push_back( (int)syscall( SYS_gettid ) );
+		return tids;
+	}
+
+	for ( struct dirent *entry = readdir( dir ); entry not_eq NULL; entry = readdir( dir ) )
+		if ( entry->d_name[0] >= '0' and entry->d_name[0] <= '9' ) tids.push_back( atoi( entry->d_name ) );
+
+	closedir( dir );
+	return tids;
+};
+#endif
+
+
+bool PerfCounters::Open( void )
+{
+	Close();
+
+#if defined(__linux__)
+	std::vector<int> tids = Threads();
+
+	for ( int c = 0; c < PERF_COUNTERS; c++ )
+	{
+		struct perf_event_attr attr;
+		memset( &attr, 0, sizeof(attr) );
+		attr.size = sizeof(attr);
+		Event( c, attr.type, attr.config );
+
+		/* the user code of the solver only, which perf_event_paranoid 2 allows, *
+		 * and the threads started after, the pool resized or the exporter      */
+		attr.inherit        = 1;
+		attr.exclude_kernel = 1;
+		attr.exclude_hv     = 1;
+		attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		for ( size_t t = 0; t < tids.size(); t++ )
+		{
+			int fd = (int)syscall( SYS_perf_event_open, &attr, tids[t], -1, -1, 0 );
+
+			/* a thread that ended meanwhile is not missed */
+			if ( fd >= 0 ) m_fds[c].push_back( fd );
+			elif ( m_error[c].empty() ) m_error[c] = strerror( errno );
+		}
+
+		if ( m_fds[c].size() > 0 ) m_error[c].clear();
+	}
+#else
+	for ( int c = 0; c < PERF_COUNTERS; c++ ) m_error[c] = "counted on Linux only";
+#endif
+
+	return IsOpen();
+};
+
+
+void PerfCounters::Close( void )
+{
+	for ( int c = 0; c < PERF_COUNTERS; c++ )
+	{
+#if defined(__linux__)
+		for ( size_t t = 0; t < m_fds[c].size(); t++ ) close( m_fds[c][t] );
+#endif
+		m_fds[c].clear();
+		m_error[c].clear();
+	}
+};
+
+
+bool PerfCounters::IsOpen( void ) const
+{
+	for ( int c = 0; c < PERF_COUNTERS; c++ ) if ( Has( c ) ) return true;
+	return false;
+};
+
+
+void PerfCounters::Read( unsigned long long values[PERF_COUNTERS] ) const
+{
+	for ( int c = 0; c < PERF_COUNTERS; c++ )
+	{
+		values[c] = 0;
+
+#if defined(__linux__)
+		for ( size_t t = 0; t < m_fds[c].size(); t++ )
+		{
+			/* the count, and the time enabled and actually counting */
+			unsigned long long data[3];
+			if ( read( m_fds[c][t], data, sizeof(data) ) not_eq (ssize_t)sizeof(data) ) continue;
+
+			if ( data[2] > 0 and data[2] < data[1] )
+				values[c] += (unsigned long long)( (double)data[0] * data[1] / data[2] );
+			else
+				values[c] += data[0];
+		}
+#endif
+	}
+};
+
+
+const char *PerfCounters::Name( cint counter )
+{
+	static const char *names[PERF_COUNTERS] = { "cycles", "instructions", "LLC misses", "dTLB misses" };
+	return ( counter >= 0 and counter < PERF_COUNTERS ) ? names[counter] : "";
+};
+
+
+const char *PerfCounters::StageName( cint stage )
+{
+	static const char *names[PERF_STAGES] = { "source", "diffusion", "advection", "projection", "volume" };
+	return ( stage >= 0 and stage < PERF_STAGES ) ? names[stage] : "";
+};
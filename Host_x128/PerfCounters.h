@@ -0,0 +1,135 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     PerfCounters.h
+*/
+
+#ifndef __perf_counters_h_
+#define __perf_counters_h_
+
+#include <vector>
+#include <string>
+#include "ISO646.h"
+
+namespace sge
+{
+	/* hardware events counted for the stages of the solver */
+	enum PERFCOUNTER
+	{
+		PERF_CYCLES       = 0,
+		PERF_INSTRUCTIONS = 1,
+		PERF_LLC_MISSES   = 2, // loads missing the last level cache, to memory
+		PERF_DTLB_MISSES  = 3, // loads missing the first level data TLB
+		PERF_COUNTERS     = 4,
+	};
+
+
+	/* the stages counted apart, on the grid only, the subnodes are solved side *
+	 * by side and would count each other                                       */
+	enum PERFSTAGE
+	{
+		PERF_SOURCE     = 0, // SourceSolver
+		PERF_DIFFUSION  = 1,
+		PERF_ADVECTION  = 2,
+		PERF_PROJECTION = 3,
+		PERF_VOLUME     = 4, // GenerVolumeImg
+		PERF_STAGES     = 5,
+	};
+
+
+	/* the counts of a stage summed over its calls */
+	struct PERFSAMPLE
+	{
+		unsigned long long counts[PERF_COUNTERS];
+		int calls;
+
+		PERFSAMPLE( void ) { Clear(); };
+
+		void Clear( void )
+		{
+			for ( int i = 0; i < PERF_COUNTERS; i++ ) counts[i] = 0;
+			calls = 0;
+		};
+	};
+
+
+	/* the hardware counters of the whole process through perf_event_open, Linux *
+	 * only: every thread running when opened, and the threads they start later, *
+	 * summed; a counter the CPU or the kernel does not offer is left out, the    *
+	 * others are still counted                                                  */
+	class PerfCounters
+	{
+	private:
+		/* a file descriptor per counter and thread */
+		std::vector<int> m_fds[PERF_COUNTERS];
+
+		/* why each counter is missing, if it is */
+		std::string m_error[PERF_COUNTERS];
+
+	public:
+		PerfCounters( void ) {};
+
+		~PerfCounters( void ) { Close(); };
+
+	public:
+		/* false if not a single counter could be opened */
+		bool Open( void );
+
+		void Close( void );
+
+		bool IsOpen( void ) const;
+
+		bool Has( cint counter ) const { return m_fds[counter].size() > 0; };
+
+		const std::string &Error( cint counter ) const { return m_error[counter]; };
+
+		/* the counts since Open, scaled up for the time a counter was multiplexed *
+		 * out, 0 for the counters missing                                        */
+		void Read( unsigned long long values[PERF_COUNTERS] ) const;
+
+		static const char *Name( cint counter );
+
+		static const char *StageName( cint stage );
+
+	private:
+		PerfCounters( const PerfCounters& );
+		PerfCounters &operator=( const PerfCounters& );
+	};
+
+
+	/* adds the counts of its scope to sample, if the counters are open and on */
+	class PerfScope
+	{
+	private:
+		const PerfCounters *m_perf;
+		PERFSAMPLE *m_sample;
+		unsigned long long m_begin[PERF_COUNTERS];
+
+	public:
+		PerfScope( const PerfCounters &perf, PERFSAMPLE &sample, const bool on = true )
+			: m_perf( on and perf.IsOpen() ? &perf : NULL ), m_sample( &sample )
+		{
+			if ( m_perf not_eq NULL ) m_perf->Read( m_begin );
+		};
+
+		~PerfScope( void )
+		{
+			if ( m_perf eqt NULL ) return;
+
+			unsigned long long end[PERF_COUNTERS];
+			m_perf->Read( end );
+
+			for ( int i = 0; i < PERF_COUNTERS; i++ )
+				m_sample->counts[i] += ( end[i] > m_begin[i] ) ? end[i] - m_begin[i] : 0;
+			m_sample->calls++;
+		};
+
+	private:
+		PerfScope( const PerfScope& );
+		PerfScope &operator=( const PerfScope& );
+	};
+};
+
+#endif
@@ -0,0 +1,110 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Simd.cpp
+*/
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+#include "Simd.h"
+
+using namespace sge;
+
+
+#if defined(_MSC_VER)
+
+/* the CPU has to offer the instructions and the OS has to save the registers */
+static SIMD QuerySimd( void )
+{
+	int info[4];
+
+	__cpuid( info, 0 );
+	if ( info[0] < 7 ) return SIMD_SCALAR;
+
+	/* OSXSAVE */
+	__cpuid( info, 1 );
+	if ( not ( info[2] & ( 1 << 27 ) ) ) return SIMD_SCALAR;
+
+	unsigned long long xcr0 = _xgetbv( 0 );
+	if ( ( xcr0 & 0x6 ) not_eq 0x6 ) return SIMD_SCALAR;
+
+	__cpuidex( info, 7, 0 );
+	bool avx2    = ( info[1] & ( 1 << 5 ) ) not_eq 0;
+	bool avx512f = ( info[1] & ( 1 << 16 ) ) not_eq 0 and ( xcr0 & 0xe0 ) eqt 0xe0;
+
+#if not defined(SIMD_NO_AVX512)
+	if ( avx512f ) return SIMD_AVX512;
+#endif
+	if ( avx2 ) return SIMD_AVX2;
+	return SIMD_SCALAR;
+};
+
+#elif defined(__GNUC__) and ( defined(__x86_64__) or defined(__i386__) )
+
+static SIMD QuerySimd( void )
+{
+	__builtin_cpu_init();
+
+	if ( __builtin_cpu_supports( "avx512f" ) ) return SIMD_AVX512;
+	if ( __builtin_cpu_supports( "avx2" ) ) return SIMD_AVX2;
+	return SIMD_SCALAR;
+};
+
+#else
+
+static SIMD QuerySimd( void ) { return SIMD_SCALAR; };
+
+#endif
+
+
+SIMD sge::DetectSimd( void )
+{
+	static const SIMD simd = QuerySimd();
+	return simd;
+};
+
+
+const char *sge::SimdName( const SIMD simd )
+{
+	switch ( simd )
+	{
+	case SIMD_AVX2:   return "avx2";
+	case SIMD_AVX512: return "avx512";
+	default:          return "scalar";
+	}
+};
+
+
+namespace sge
+{
+	template <>
+	const STENCILROWS<double> *StencilRows<double>( const SIMD simd )
+	{
+		switch ( simd )
+		{
+#if not defined(SIMD_NO_AVX512)
+		case SIMD_AVX512: return &t_avx512double;
+#endif
+		case SIMD_AVX2:   return &t_avx2double;
+		default:          return NULL;
+		}
+	};
+
+
+	template <>
+	const STENCILROWS<float> *StencilRows<float>( const SIMD simd )
+	{
+		switch ( simd )
+		{
+#if not defined(SIMD_NO_AVX512)
+		case SIMD_AVX512: return &t_avx512float;
+#endif
+		case SIMD_AVX2:   return &t_avx2float;
+		default:          return NULL;
+		}
+	};
+};
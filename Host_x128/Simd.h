@@ -0,0 +1,86 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Simd.h
+*/
+
+#ifndef __simd_h_
+#define __simd_h_
+
+#include <stddef.h>
+#include "ISO646.h"
+
+/* AVX-512 intrinsics arrived with Visual Studio 2017 */
+#if defined(_MSC_VER) and _MSC_VER < 1910
+#define SIMD_NO_AVX512
+#endif
+
+namespace sge
+{
+	/* instruction sets the stencil rows are written for, in increasing order */
+	enum SIMD
+	{
+		SIMD_SCALAR = 0, // the templated loops of Kernels.h, the reference
+		SIMD_AVX2   = 1, // 256 bit vectors
+		SIMD_AVX512 = 2, // 512 bit vectors, masked stores
+	};
+
+
+	/* the widest instruction set both compiled in and supported by this CPU */
+	SIMD DetectSimd( void );
+
+	const char *SimdName( const SIMD simd );
+
+
+	/* one row of a stencil, from cell i0 of the row up to i1, all pointers address *
+	 * cell 0 of the row, sx and sxy are the distances to the next row and slab;    *
+	 * every row computes exactly the same expression as its scalar counterpart    */
+	template <typename T>
+	struct STENCILROWS
+	{
+		/* out[i] = ( in[i] + diff * sum of the six neighbours of src[i] ) / dix for *
+		 * every step-th cell, step is either 1 or 2                                 */
+		void (*jacobi)( T *out, const T *src, const T *in, const ptrdiff_t sx, const ptrdiff_t sxy,
+			cint i0, cint i1, cint step, const T diff, const T dix );
+
+		/* div[i] = -1/3 * central differences of u, v, w divided by nx, ny, nz, prs[i] = 0 */
+		void (*gradient)( T *div, T *prs, const T *u, const T *v, const T *w,
+			const ptrdiff_t sx, const ptrdiff_t sxy, cint i0, cint i1, const T nx, const T ny, const T nz );
+
+		/* u[i] -= hx * central difference of prs, and so on for v and w */
+		void (*subtract)( T *u, T *v, T *w, const T *prs,
+			const ptrdiff_t sx, const ptrdiff_t sxy, cint i0, cint i1, const T hx, const T hy, const T hz );
+
+		/* out[i] = in sampled where cell ( i, j, k ) of an nx * ny * nz grid is traced back *
+		 * to, ( i, j, k ) - h * ( u[i], v[i], w[i] ), by the sampler of Kernels.h; reads  *
+		 * one shell of ghost cells around the grid                                       */
+		void (*advection)( T *out, const T *in, const T *u, const T *v, const T *w,
+			const ptrdiff_t sx, const ptrdiff_t sxy, cint j, cint k, cint i0, cint i1,
+			const T h, cint nx, cint ny, cint nz );
+
+		/* advection of u, v and w by themselves into outu, outv and outw */
+		void (*vectoradvection)( T *outu, T *outv, T *outw, const T *u, const T *v, const T *w,
+			const ptrdiff_t sx, const ptrdiff_t sxy, cint j, cint k, cint i0, cint i1,
+			const T h, cint nx, cint ny, cint nz );
+	};
+
+
+	/* rows of the given instruction set, NULL for SIMD_SCALAR */
+	template <typename T>
+	const STENCILROWS<T> *StencilRows( const SIMD simd );
+
+	template <>
+	const STENCILROWS<double> *StencilRows<double>( const SIMD simd );
+
+	template <>
+	const STENCILROWS<float> *StencilRows<float>( const SIMD simd );
+
+
+	/* tables defined by SimdAvx2.cpp and SimdAvx512.cpp */
+	extern const STENCILROWS<double> t_avx2double, t_avx512double;
+	extern const STENCILROWS<float>  t_avx2float,  t_avx512float;
+};
+
+#endif
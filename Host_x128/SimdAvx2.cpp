@@ -0,0 +1,102 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     SimdAvx2.cpp
+*/
+
+#include <immintrin.h>
+#include "Simd.h"
+
+/* everything below is built for AVX2, whatever the flags of the project say, *
+ * and only ever called after DetectSimd found the instruction set            */
+#if defined(__clang__)
+#pragma clang attribute push( __attribute__((target("avx2"))), apply_to = function )
+#elif defined(__GNUC__)
+#pragma GCC push_options
+/* the intrinsics start from an undefined register, which GCC reports as uninitialized */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC target("avx2")
+#endif
+
+#include "SimdRows.h"
+
+namespace sge
+{
+	struct AVX2DOUBLE
+	{
+		typedef double  T;
+		typedef __m256d R;
+		typedef __m128i I;
+		enum { W = 4 };
+
+		static inline R load( const T *p ) { return _mm256_loadu_pd( p ); };
+		static inline void store( T *p, const R x ) { _mm256_storeu_pd( p, x ); };
+		static inline void storeeven( T *p, const R x ) { _mm256_maskstore_pd( p, _mm256_setr_epi64x( -1, 0, -1, 0 ), x ); };
+		static inline R set1( const T x ) { return _mm256_set1_pd( x ); };
+
+		static inline R add( const R a, const R b ) { return _mm256_add_pd( a, b ); };
+		static inline R sub( const R a, const R b ) { return _mm256_sub_pd( a, b ); };
+		static inline R mul( const R a, const R b ) { return _mm256_mul_pd( a, b ); };
+		static inline R div( const R a, const R b ) { return _mm256_div_pd( a, b ); };
+		static inline R min( const R a, const R b ) { return _mm256_min_pd( a, b ); };
+		static inline R max( const R a, const R b ) { return _mm256_max_pd( a, b ); };
+
+		static inline R floor( const R x ) { return _mm256_floor_pd( x ); };
+		static inline R iota( void ) { return _mm256_setr_pd( 0, 1, 2, 3 ); };
+
+		static inline I toint( const R x ) { return _mm256_cvttpd_epi32( x ); };
+		static inline I iadd( const I a, const I b ) { return _mm_add_epi32( a, b ); };
+		static inline I imul( const I a, const I b ) { return _mm_mullo_epi32( a, b ); };
+		static inline I iset1( cint x ) { return _mm_set1_epi32( x ); };
+		static inline R gather( const T *p, const I i ) { return _mm256_i32gather_pd( p, i, 8 ); };
+	};
+
+
+	struct AVX2FLOAT
+	{
+		typedef float  T;
+		typedef __m256 R;
+		typedef __m256i I;
+		enum { W = 8 };
+
+		static inline R load( const T *p ) { return _mm256_loadu_ps( p ); };
+		static inline void store( T *p, const R x ) { _mm256_storeu_ps( p, x ); };
+		static inline void storeeven( T *p, const R x ) { _mm256_maskstore_ps( p, _mm256_setr_epi32( -1, 0, -1, 0, -1, 0, -1, 0 ), x ); };
+		static inline R set1( const T x ) { return _mm256_set1_ps( x ); };
+
+		static inline R add( const R a, const R b ) { return _mm256_add_ps( a, b ); };
+		static inline R sub( const R a, const R b ) { return _mm256_sub_ps( a, b ); };
+		static inline R mul( const R a, const R b ) { return _mm256_mul_ps( a, b ); };
+		static inline R div( const R a, const R b ) { return _mm256_div_ps( a, b ); };
+		static inline R min( const R a, const R b ) { return _mm256_min_ps( a, b ); };
+		static inline R max( const R a, const R b ) { return _mm256_max_ps( a, b ); };
+
+		static inline R floor( const R x ) { return _mm256_floor_ps( x ); };
+		static inline R iota( void ) { return _mm256_setr_ps( 0, 1, 2, 3, 4, 5, 6, 7 ); };
+
+		static inline I toint( const R x ) { return _mm256_cvttps_epi32( x ); };
+		static inline I iadd( const I a, const I b ) { return _mm256_add_epi32( a, b ); };
+		static inline I imul( const I a, const I b ) { return _mm256_mullo_epi32( a, b ); };
+		static inline I iset1( cint x ) { return _mm256_set1_epi32( x ); };
+		static inline R gather( const T *p, const I i ) { return _mm256_i32gather_ps( p, i, 4 ); };
+	};
+
+
+	const STENCILROWS<double> t_avx2double =
+		{ &rowJacobi<AVX2DOUBLE>, &rowGradient<AVX2DOUBLE>, &rowSubtract<AVX2DOUBLE>,
+		&rowAdvection<AVX2DOUBLE>, &rowVectorAdvection<AVX2DOUBLE> };
+
+	const STENCILROWS<float> t_avx2float =
+		{ &rowJacobi<AVX2FLOAT>, &rowGradient<AVX2FLOAT>, &rowSubtract<AVX2FLOAT>,
+		&rowAdvection<AVX2FLOAT>, &rowVectorAdvection<AVX2FLOAT> };
+};
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
@@ -0,0 +1,106 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     SimdAvx512.cpp
+*/
+
+#include <immintrin.h>
+#include "Simd.h"
+
+#if not defined(SIMD_NO_AVX512)
+
+/* everything below is built for AVX-512F, whatever the flags of the project say, *
+ * and only ever called after DetectSimd found the instruction set                */
+#if defined(__clang__)
+#pragma clang attribute push( __attribute__((target("avx512f"))), apply_to = function )
+#elif defined(__GNUC__)
+#pragma GCC push_options
+/* the intrinsics start from an undefined register, which GCC reports as uninitialized */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#pragma GCC target("avx512f")
+#endif
+
+#include "SimdRows.h"
+
+namespace sge
+{
+	struct AVX512DOUBLE
+	{
+		typedef double  T;
+		typedef __m512d R;
+		typedef __m256i I;
+		enum { W = 8 };
+
+		static inline R load( const T *p ) { return _mm512_loadu_pd( p ); };
+		static inline void store( T *p, const R x ) { _mm512_storeu_pd( p, x ); };
+		static inline void storeeven( T *p, const R x ) { _mm512_mask_storeu_pd( p, 0x55, x ); };
+		static inline R set1( const T x ) { return _mm512_set1_pd( x ); };
+
+		static inline R add( const R a, const R b ) { return _mm512_add_pd( a, b ); };
+		static inline R sub( const R a, const R b ) { return _mm512_sub_pd( a, b ); };
+		static inline R mul( const R a, const R b ) { return _mm512_mul_pd( a, b ); };
+		static inline R div( const R a, const R b ) { return _mm512_div_pd( a, b ); };
+		static inline R min( const R a, const R b ) { return _mm512_min_pd( a, b ); };
+		static inline R max( const R a, const R b ) { return _mm512_max_pd( a, b ); };
+
+		static inline R floor( const R x ) { return _mm512_roundscale_pd( x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC ); };
+		static inline R iota( void ) { return _mm512_setr_pd( 0, 1, 2, 3, 4, 5, 6, 7 ); };
+
+		static inline I toint( const R x ) { return _mm512_cvttpd_epi32( x ); };
+		static inline I iadd( const I a, const I b ) { return _mm256_add_epi32( a, b ); };
+		static inline I imul( const I a, const I b ) { return _mm256_mullo_epi32( a, b ); };
+		static inline I iset1( cint x ) { return _mm256_set1_epi32( x ); };
+		static inline R gather( const T *p, const I i ) { return _mm512_i32gather_pd( i, p, 8 ); };
+	};
+
+
+	struct AVX512FLOAT
+	{
+		typedef float  T;
+		typedef __m512 R;
+		typedef __m512i I;
+		enum { W = 16 };
+
+		static inline R load( const T *p ) { return _mm512_loadu_ps( p ); };
+		static inline void store( T *p, const R x ) { _mm512_storeu_ps( p, x ); };
+		static inline void storeeven( T *p, const R x ) { _mm512_mask_storeu_ps( p, 0x5555, x ); };
+		static inline R set1( const T x ) { return _mm512_set1_ps( x ); };
+
+		static inline R add( const R a, const R b ) { return _mm512_add_ps( a, b ); };
+		static inline R sub( const R a, const R b ) { return _mm512_sub_ps( a, b ); };
+		static inline R mul( const R a, const R b ) { return _mm512_mul_ps( a, b ); };
+		static inline R div( const R a, const R b ) { return _mm512_div_ps( a, b ); };
+		static inline R min( const R a, const R b ) { return _mm512_min_ps( a, b ); };
+		static inline R max( const R a, const R b ) { return _mm512_max_ps( a, b ); };
+
+		static inline R floor( const R x ) { return _mm512_roundscale_ps( x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC ); };
+		static inline R iota( void ) { return _mm512_setr_ps( 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 ); };
+
+		static inline I toint( const R x ) { return _mm512_cvttps_epi32( x ); };
+		static inline I iadd( const I a, const I b ) { return _mm512_add_epi32( a, b ); };
+		static inline I imul( const I a, const I b ) { return _mm512_mullo_epi32( a, b ); };
+		static inline I iset1( cint x ) { return _mm512_set1_epi32( x ); };
+		static inline R gather( const T *p, const I i ) { return _mm512_i32gather_ps( i, p, 4 ); };
+	};
+
+
+	const STENCILROWS<double> t_avx512double =
+		{ &rowJacobi<AVX512DOUBLE>, &rowGradient<AVX512DOUBLE>, &rowSubtract<AVX512DOUBLE>,
+		&rowAdvection<AVX512DOUBLE>, &rowVectorAdvection<AVX512DOUBLE> };
+
+	const STENCILROWS<float> t_avx512float =
+		{ &rowJacobi<AVX512FLOAT>, &rowGradient<AVX512FLOAT>, &rowSubtract<AVX512FLOAT>,
+		&rowAdvection<AVX512FLOAT>, &rowVectorAdvection<AVX512FLOAT> };
+};
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#elif defined(__GNUC__)
+#pragma GCC diagnostic pop
+#pragma GCC pop_options
+#endif
+
+#endif
@@ -0,0 +1,314 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     SimdRows.h
+*/
+
+#ifndef __simd_rows_h_
+#define __simd_rows_h_
+
+#include "Simd.h"
+
+/* the stencil rows of Simd.h written once over a vector type V, which supplies *
+ *   T, R, W                        scalar, register and lanes per register     *
+ *   load, store, storeeven, set1   unaligned memory access, broadcast          *
+ *   add, sub, mul, div, min, max   min and max return b if either is NaN       *
+ *   floor, iota                    round down, and 0, 1, ... W - 1             *
+ *   I, toint, iadd, imul, iset1    W 32 bit indices, truncation from R         *
+ *   gather                         T at base + index for every lane            *
+ * only SimdAvx2.cpp and SimdAvx512.cpp include this file, after switching the *
+ * compiler to their instruction set, so that every instantiation is built    *
+ * for the CPU it is dispatched to. the lanes perform the very same operations *
+ * in the same order as the scalar loops, so with FMA contraction turned off   *
+ * ( see the Makefile ) the results are identical to the last bit              */
+
+namespace sge
+{
+	/* ( in + diff * sum of the six neighbours of src ) / dix on the W cells from src */
+	template <class V>
+	inline typename V::R JacobiLanes( const typename V::T *src, const typename V::T *in,
+		const ptrdiff_t sx, const ptrdiff_t sxy, const typename V::R diff, const typename V::R dix )
+	{
+		typename V::R sum = V::add( V::load( src - 1 ), V::load( src + 1 ) );
+		sum = V::add( sum, V::load( src - sx ) );
+		sum = V::add( sum, V::load( src + sx ) );
+		sum = V::add( sum, V::load( src - sxy ) );
+		sum = V::add( sum, V::load( src + sxy ) );
+
+		return V::div( V::add( V::load( in ), V::mul( diff, sum ) ), dix );
+	};
+
+
+	template <class V>
+	void rowJacobi( typename V::T *out, const typename V::T *src, const typename V::T *in,
+		const ptrdiff_t sx, const ptrdiff_t sxy, cint i0, cint i1, cint step,
+		const typename V::T diff, const typename V::T dix )
+	{
+		typedef typename V::R R;
+
+		const R vdiff = V::set1( diff );
+		const R vdix  = V::set1( dix );
+
+		int i = i0;
+
+		if ( step eqt 1 )
+		{
+			for ( ; i + V::W <= i1; i += V::W )
+				V::store( out + i, JacobiLanes<V>( src + i, in + i, sx, sxy, vdiff, vdix ) );
+		}
+		elif ( i + V::W <= i1 )
+		{
+			/* in place, only the even lanes are stored; the odd lanes the next vector reads *
+			 * through src[i - 1] are left alone, but a load overlapping a masked store that *
+			 * is still in flight cannot be forwarded, and stalls until the store retires,   *
+			 * so every vector is stored only after the loads of the next one are issued     */
+			R x = JacobiLanes<V>( src + i, in + i, sx, sxy, vdiff, vdix );
+
+			for ( i += V::W; i + V::W <= i1; i += V::W )
+			{
+				R next = JacobiLanes<V>( src + i, in + i, sx, sxy, vdiff, vdix );
+				V::storeeven( out + i - V::W, x );
+				x = next;
+			}
+			V::storeeven( out + i - V::W, x );
+		}
+
+		for ( ; i < i1; i += step )
+		{
+			out[i] = ( in[i] + diff * (
+				src[i - 1] + src[i + 1] +
+				src[i - sx] + src[i + sx] +
+				src[i - sxy] + src[i + sxy] ) ) / dix;
+		}
+	};
+
+
+	template <class V>
+	void rowGradient( typename V::T *div, typename V::T *prs,
+		const typename V::T *u, const typename V::T *v, const typename V::T *w,
+		const ptrdiff_t sx, const ptrdiff_t sxy, cint i0, cint i1,
+		const typename V::T nx, const typename V::T ny, const typename V::T nz )
+	{
+		typedef typename V::T T;
+		typedef typename V::R R;
+
+		const T third = -1.f / 3.f;
+
+		const R vthird = V::set1( third );
+		const R vnx = V::set1( nx ), vny = V::set1( ny ), vnz = V::set1( nz );
+		const R zero = V::set1( 0 );
+
+		int i = i0;
+
+		for ( ; i + V::W <= i1; i += V::W )
+		{
+			R du = V::div( V::sub( V::load( u + i + 1 ), V::load( u + i - 1 ) ), vnx );
+			R dv = V::div( V::sub( V::load( v + i + sx ), V::load( v + i - sx ) ), vny );
+			R dw = V::div( V::sub( V::load( w + i + sxy ), V::load( w + i - sxy ) ), vnz );
+
+			V::store( div + i, V::mul( vthird, V::add( V::add( du, dv ), dw ) ) );
+			V::store( prs + i, zero );
+		}
+
+		for ( ; i < i1; i++ )
+		{
+			div[i] = third * (
+				( u[i + 1] - u[i - 1] ) / nx +
+				( v[i + sx] - v[i - sx] ) / ny +
+				( w[i + sxy] - w[i - sxy] ) / nz );
+			prs[i] = 0.f;
+		}
+	};
+
+
+	template <class V>
+	void rowSubtract( typename V::T *u, typename V::T *v, typename V::T *w, const typename V::T *prs,
+		const ptrdiff_t sx, const ptrdiff_t sxy, cint i0, cint i1,
+		const typename V::T hx, const typename V::T hy, const typename V::T hz )
+	{
+		typedef typename V::R R;
+
+		const R vhx = V::set1( hx ), vhy = V::set1( hy ), vhz = V::set1( hz );
+
+		int i = i0;
+
+		for ( ; i + V::W <= i1; i += V::W )
+		{
+			V::store( u + i, V::sub( V::load( u + i ),
+				V::mul( vhx, V::sub( V::load( prs + i + 1 ), V::load( prs + i - 1 ) ) ) ) );
+			V::store( v + i, V::sub( V::load( v + i ),
+				V::mul( vhy, V::sub( V::load( prs + i + sx ), V::load( prs + i - sx ) ) ) ) );
+			V::store( w + i, V::sub( V::load( w + i ),
+				V::mul( vhz, V::sub( V::load( prs + i + sxy ), V::load( prs + i - sxy ) ) ) ) );
+		}
+
+		for ( ; i < i1; i++ )
+		{
+			u[i] -= hx * ( prs[i + 1] - prs[i - 1] );
+			v[i] -= hy * ( prs[i + sx] - prs[i - sx] );
+			w[i] -= hz * ( prs[i + sxy] - prs[i - sxy] );
+		}
+	};
+
+
+	/* the sampler of Kernels.h on one lane, the cell addressed relative to cell 0 *
+	 * of row ( j, k ) of grid                                                     */
+	template <typename T>
+	inline int CellScalar( T &x, cint n )
+	{
+		x = ( x > -1 ) ? x : -1;
+		x = ( x < n ) ? x : n;
+
+		int i = (int)x;
+		i -= ( x < i );
+
+		return ( i < n - 1 ) ? i : n - 1;
+	};
+
+
+	template <typename T>
+	inline T LerpScalar( const T *grid, const ptrdiff_t c, const ptrdiff_t sx, const ptrdiff_t sxy,
+		const T dx, const T dy, const T dz )
+	{
+		T c00 = grid[c] * ( 1 - dx ) + grid[c + 1] * dx;
+		T c10 = grid[c + sx] * ( 1 - dx ) + grid[c + 1 + sx] * dx;
+		T c01 = grid[c + sxy] * ( 1 - dx ) + grid[c + 1 + sxy] * dx;
+		T c11 = grid[c + sx + sxy] * ( 1 - dx ) + grid[c + 1 + sx + sxy] * dx;
+
+		T c0 = c00 * ( 1 - dy ) + c10 * dy;
+		T c1 = c01 * ( 1 - dy ) + c11 * dy;
+
+		return c0 * ( 1 - dz ) + c1 * dz;
+	};
+
+
+	/* cells and weights of the W points x, y, z, which are clamped as CellScalar does */
+	template <class V>
+	struct CellLanes
+	{
+		typename V::I c;
+		typename V::R dx, dy, dz;
+
+		CellLanes( typename V::R x, typename V::R y, typename V::R z,
+			cint j, cint k, cint nx, cint ny, cint nz, const ptrdiff_t sx, const ptrdiff_t sxy )
+		{
+			typedef typename V::R R;
+
+			const R ghost = V::set1( -1 );
+
+			x = V::min( V::max( x, ghost ), V::set1( (typename V::T)nx ) );
+			y = V::min( V::max( y, ghost ), V::set1( (typename V::T)ny ) );
+			z = V::min( V::max( z, ghost ), V::set1( (typename V::T)nz ) );
+
+			R i = V::min( V::floor( x ), V::set1( (typename V::T)( nx - 1 ) ) );
+			R jj = V::min( V::floor( y ), V::set1( (typename V::T)( ny - 1 ) ) );
+			R kk = V::min( V::floor( z ), V::set1( (typename V::T)( nz - 1 ) ) );
+
+			dx = V::sub( x, i );
+			dy = V::sub( y, jj );
+			dz = V::sub( z, kk );
+
+			/* in 32 bit integers, floats would not hold the index of a large grid exactly */
+			c = V::iadd( V::toint( i ), V::iadd(
+				V::imul( V::iadd( V::toint( jj ), V::iset1( -j ) ), V::iset1( (int)sx ) ),
+				V::imul( V::iadd( V::toint( kk ), V::iset1( -k ) ), V::iset1( (int)sxy ) ) ) );
+		};
+
+		inline typename V::R Lerp( const typename V::T *grid, const ptrdiff_t sx, const ptrdiff_t sxy ) const
+		{
+			typedef typename V::R R;
+			const R one = V::set1( 1 );
+			const R rx = V::sub( one, dx ), ry = V::sub( one, dy ), rz = V::sub( one, dz );
+
+			R c00 = V::add( V::mul( V::gather( grid, c ), rx ), V::mul( V::gather( grid + 1, c ), dx ) );
+			R c10 = V::add( V::mul( V::gather( grid + sx, c ), rx ), V::mul( V::gather( grid + 1 + sx, c ), dx ) );
+			R c01 = V::add( V::mul( V::gather( grid + sxy, c ), rx ), V::mul( V::gather( grid + 1 + sxy, c ), dx ) );
+			R c11 = V::add( V::mul( V::gather( grid + sx + sxy, c ), rx ), V::mul( V::gather( grid + 1 + sx + sxy, c ), dx ) );
+
+			R c0 = V::add( V::mul( c00, ry ), V::mul( c10, dy ) );
+			R c1 = V::add( V::mul( c01, ry ), V::mul( c11, dy ) );
+
+			return V::add( V::mul( c0, rz ), V::mul( c1, dz ) );
+		};
+	};
+
+
+	template <class V>
+	void rowAdvection( typename V::T *out, const typename V::T *in,
+		const typename V::T *u, const typename V::T *v, const typename V::T *w,
+		const ptrdiff_t sx, const ptrdiff_t sxy, cint j, cint k, cint i0, cint i1,
+		const typename V::T h, cint nx, cint ny, cint nz )
+	{
+		typedef typename V::T T;
+		typedef typename V::R R;
+
+		const R vh = V::set1( h );
+		const R vj = V::set1( (T)j ), vk = V::set1( (T)k );
+
+		int i = i0;
+
+		for ( ; i + V::W <= i1; i += V::W )
+		{
+			R vi = V::add( V::set1( (T)i ), V::iota() );
+
+			CellLanes<V> cell( V::sub( vi, V::mul( V::load( u + i ), vh ) ),
+				V::sub( vj, V::mul( V::load( v + i ), vh ) ),
+				V::sub( vk, V::mul( V::load( w + i ), vh ) ), j, k, nx, ny, nz, sx, sxy );
+
+			V::store( out + i, cell.Lerp( in, sx, sxy ) );
+		}
+
+		for ( ; i < i1; i++ )
+		{
+			T x = i - u[i] * h, y = j - v[i] * h, z = k - w[i] * h;
+
+			int ci = CellScalar( x, nx ), cj = CellScalar( y, ny ), ck = CellScalar( z, nz );
+			out[i] = LerpScalar( in, ci + ( cj - j ) * sx + ( ck - k ) * sxy, sx, sxy, x - ci, y - cj, z - ck );
+		}
+	};
+
+
+	template <class V>
+	void rowVectorAdvection( typename V::T *outu, typename V::T *outv, typename V::T *outw,
+		const typename V::T *u, const typename V::T *v, const typename V::T *w,
+		const ptrdiff_t sx, const ptrdiff_t sxy, cint j, cint k, cint i0, cint i1,
+		const typename V::T h, cint nx, cint ny, cint nz )
+	{
+		typedef typename V::T T;
+		typedef typename V::R R;
+
+		const R vh = V::set1( h );
+		const R vj = V::set1( (T)j ), vk = V::set1( (T)k );
+
+		int i = i0;
+
+		for ( ; i + V::W <= i1; i += V::W )
+		{
+			R vi = V::add( V::set1( (T)i ), V::iota() );
+
+			CellLanes<V> cell( V::sub( vi, V::mul( V::load( u + i ), vh ) ),
+				V::sub( vj, V::mul( V::load( v + i ), vh ) ),
+				V::sub( vk, V::mul( V::load( w + i ), vh ) ), j, k, nx, ny, nz, sx, sxy );
+
+			V::store( outu + i, cell.Lerp( u, sx, sxy ) );
+			V::store( outv + i, cell.Lerp( v, sx, sxy ) );
+			V::store( outw + i, cell.Lerp( w, sx, sxy ) );
+		}
+
+		for ( ; i < i1; i++ )
+		{
+			T x = i - u[i] * h, y = j - v[i] * h, z = k - w[i] * h;
+
+			int ci = CellScalar( x, nx ), cj = CellScalar( y, ny ), ck = CellScalar( z, nz );
+			ptrdiff_t c = ci + ( cj - j ) * sx + ( ck - k ) * sxy;
+
+			outu[i] = LerpScalar( u, c, sx, sxy, x - ci, y - cj, z - ck );
+			outv[i] = LerpScalar( v, c, sx, sxy, x - ci, y - cj, z - ck );
+			outw[i] = LerpScalar( w, c, sx, sxy, x - ci, y - cj, z - ck );
+		}
+	};
+};
+
+#endif
@@ -0,0 +1,451 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Snapshot.cpp
+*/
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "MacroDefinition.h"
+#include "FluidSimProc.h"
+#include "Snapshot.h"
+#include "StopWatch.h"
+#include "Trace.h"
+
+using namespace sge;
+
+/* u, v, w, their previous values, den, den0, p and obs carry over from a step to *
+ * the next, div and tmp are rewritten before they are read                        */
+#define SNAPSHOT_FIELDS 10
+
+
+MappedFile::MappedFile( void ) : m_data(NULL), m_size(0)
+{
+#if defined(_WIN32)
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	m_fd = -1;
+#endif
+};
+
+
+bool MappedFile::Create( const char *path, const size_t size )
+{
+	Close();
+
+#if defined(_WIN32)
+	m_file = CreateFileA( path, GENERIC_READ | GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( m_file eqt INVALID_HANDLE_VALUE ) return false;
+
+	/* the mapping extends the file to its size */
+	m_mapping = CreateFileMappingA( m_file, NULL, PAGE_READWRITE, (DWORD)( (unsigned long long)size >> 32 ),
+		(DWORD)( size & 0xffffffff ), NULL );
+	if ( m_mapping not_eq NULL ) m_data = MapViewOfFile( m_mapping, FILE_MAP_WRITE, 0, 0, size );
+#else
+	m_fd = open( path, O_RDWR | O_CREAT | O_TRUNC, 0644 );
+	if ( m_fd < 0 ) return false;
+
+	if ( ftruncate( m_fd, (off_t)size ) eqt 0 )
+	{
+		m_data = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0 );
+		if ( m_data eqt MAP_FAILED ) m_data = NULL;
+	}
+#endif
+
+	if ( m_data eqt NULL ) { Close(); return false; }
+
+	m_size = size;
+	return true;
+};
+
+
+bool MappedFile::Open( const char *path )
+{
+	Close();
+
+#if defined(_WIN32)
+	m_file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( m_file eqt INVALID_HANDLE_VALUE ) return false;
+
+	LARGE_INTEGER size;
+	if ( GetFileSizeEx( m_file, &size ) and size.QuadPart > 0 )
+	{
+		m_size = (size_t)size.QuadPart;
+		m_mapping = CreateFileMappingA( m_file, NULL, PAGE_READONLY, 0, 0, NULL );
+		if ( m_mapping not_eq NULL ) m_data = MapViewOfFile( m_mapping, FILE_MAP_READ, 0, 0, 0 );
+	}
+#else
+	m_fd = open( path, O_RDONLY );
+	if ( m_fd < 0 ) return false;
+
+	struct stat st;
+	if ( fstat( m_fd, &st ) eqt 0 and st.st_size > 0 )
+	{
+		m_size = (size_t)st.st_size;
+
+		/* read in as a whole, rather than a page per fault */
+#if defined(MAP_POPULATE)
+		m_data = mmap( NULL, m_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, m_fd, 0 );
+#else
+		m_data = mmap( NULL, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0 );
+#endif
+		if ( m_data eqt MAP_FAILED ) m_data = NULL;
+		else madvise( m_data, m_size, MADV_SEQUENTIAL );
+	}
+#endif
+
+	if ( m_data eqt NULL ) { Close(); return false; }
+
+	return true;
+};
+
+
+void MappedFile::Close( void )
+{
+#if defined(_WIN32)
+	if ( m_data not_eq NULL ) UnmapViewOfFile( m_data );
+	if ( m_mapping not_eq NULL ) CloseHandle( m_mapping );
+	if ( m_file not_eq INVALID_HANDLE_VALUE ) CloseHandle( m_file );
+
+	m_file = INVALID_HANDLE_VALUE;
+	m_mapping = NULL;
+#else
+	/* the dirty pages are written back by the kernel, after the unmap as well */
+	if ( m_data not_eq NULL ) munmap( m_data, m_size );
+	if ( m_fd >= 0 ) close( m_fd );
+
+	m_fd = -1;
+#endif
+
+	m_data = NULL;
+	m_size = 0;
+};
+
+
+/* bytes copied page by page on the threads of the pool, which fault the pages *
+ * of the mapping in, or read them out, side by side; without a pool at once   */
+static void CopyPages( ThreadPool *pool, void *dst, const void *src, const size_t bytes )
+{
+	cint pages = (int)( ( bytes + SNAPSHOT_ALIGN - 1 ) / SNAPSHOT_ALIGN );
+
+	if ( pool eqt NULL ) { memcpy( dst, src, bytes ); return; }
+
+	pool->ParallelFor( 0, pages, [&]( int begin, int end )
+	{
+		const size_t first = (size_t)begin * SNAPSHOT_ALIGN;
+		const size_t last  = ( (size_t)end * SNAPSHOT_ALIGN < bytes ) ? (size_t)end * SNAPSHOT_ALIGN : bytes;
+
+		memcpy( (char*)dst + first, (const char*)src + first, last - first );
+	} );
+};
+
+
+/* the fields of a snapshot, see SNAPSHOT_FIELDS, written from f or read into f, *
+ * returning the bytes of the file that follow them                               */
+template <typename T>
+static char *SaveFields( ThreadPool *pool, char *out, const FIELDS<T> &f, const size_t elements )
+{
+	const T *fields[SNAPSHOT_FIELDS] = { f.den, f.u, f.v, f.w, f.den0, f.u0, f.v0, f.w0, f.p, f.obs };
+
+	for ( int n = 0; n < SNAPSHOT_FIELDS; n++, out += elements * sizeof(T) )
+		CopyPages( pool, out, fields[n], elements * sizeof(T) );
+
+	return out;
+};
+
+
+template <typename T>
+static const char *LoadFields( ThreadPool *pool, const char *in, FIELDS<T> &f, const size_t elements )
+{
+	T *fields[SNAPSHOT_FIELDS] = { f.den, f.u, f.v, f.w, f.den0, f.u0, f.v0, f.w0, f.p, f.obs };
+
+	for ( int n = 0; n < SNAPSHOT_FIELDS; n++, in += elements * sizeof(T) )
+		CopyPages( pool, fields[n], in, elements * sizeof(T) );
+
+	return in;
+};
+
+
+bool FluidSimProc::SaveCurStage( const char *path )
+{
+	TraceScope trace( "save", m_steps );
+	StopWatch watch;
+
+	if ( not SaveStage( path, &m_pool ) )
+	{
+		printf( "save current stage to %s failed\n", path );
+		return false;
+	}
+
+	printf( "step %d saved to %s, %.3f ms\n", m_steps, path, watch.Elapsed() * 1000.0 );
+	return true;
+};
+
+
+bool FluidSimProc::LoadPreStage( const char *path )
+{
+	TraceScope trace( "load" );
+	StopWatch watch;
+	bool loaded = false;
+
+	if ( m_scalar eqt SCALAR_FLOAT ) loaded = LoadPreStage( m_ffields, m_fnodes, path );
+	else                             loaded = LoadPreStage( m_dfields, m_dnodes, path );
+
+	if ( not loaded )
+	{
+		printf( "load previous stage from %s failed\n", path );
+		return false;
+	}
+
+	printf( "step %d loaded from %s, %.3f ms\n", m_steps, path, watch.Elapsed() * 1000.0 );
+	return true;
+};
+
+
+bool FluidSimProc::ForkCurStage( const char *path )
+{
+#if defined(_WIN32)
+	/* no fork, the solver waits for the whole snapshot */
+	StopWatch watch;
+	bool saved = SaveCurStage( path );
+	m_stall = watch.Elapsed();
+	return saved;
+#else
+	/* two children would write the same file, and double the pages copied on write */
+	if ( not WaitCheckpoint( false ) )
+	{
+		printf( "checkpoint of step %d skipped, step %d is still being written\n", m_steps, m_ckstep );
+		return false;
+	}
+
+	const string part = string( path ) + ".part";
+
+	TraceScope trace( "checkpoint", m_steps );
+	StopWatch watch;
+
+	/* else the child flushes what the parent left in the buffer a second time */
+	fflush( stdout );
+
+	pid_t pid = fork();
+	if ( pid eqt 0 )
+	{
+		/* the workers of the pool are not copied, this thread is all there is; *
+		 * it neither prints nor allocates, whatever lock a worker might hold     */
+		bool saved = SaveStage( part.c_str(), NULL ) and rename( part.c_str(), path ) eqt 0;
+		_exit( saved ? 0 : 1 );
+	}
+
+	/* the copy of the page tables, the pages themselves are copied as the solver *
+	 * writes them, over the next step or two                                      */
+	m_stall = watch.Elapsed();
+
+	if ( pid < 0 )
+	{
+		printf( "fork checkpoint of step %d failed\n", m_steps );
+		return false;
+	}
+
+	m_child   = (int)pid;
+	m_ckstep  = m_steps;
+	m_ckstart = StopWatch::Now();
+	m_ckfile  = path;
+
+	printf( "checkpoint of step %d forked, solver stalled %.3f ms\n", m_steps, m_stall * 1000.0 );
+	return true;
+#endif
+};
+
+
+bool FluidSimProc::WaitCheckpoint( const bool block )
+{
+#if not defined(_WIN32)
+	if ( m_child < 0 ) return true;
+
+	int status = 0;
+	pid_t pid = waitpid( (pid_t)m_child, &status, block ? 0 : WNOHANG );
+	if ( pid eqt 0 ) return false;
+
+	if ( pid eqt (pid_t)m_child and WIFEXITED( status ) and WEXITSTATUS( status ) eqt 0 )
+		printf( "checkpoint of step %d written to %s, %.3f ms after the fork\n", m_ckstep, m_ckfile.c_str(),
+			( StopWatch::Now() - m_ckstart ) * 1000.0 );
+	else
+		printf( "checkpoint of step %d to %s failed\n", m_ckstep, m_ckfile.c_str() );
+
+	m_child = -1;
+#endif
+	return true;
+};
+
+
+void FluidSimProc::SetCheckpoints( const char *path, cdouble seconds )
+{
+	m_ckpath   = path;
+	m_ckperiod = seconds;
+	m_cklast   = StopWatch::Now();
+};
+
+
+bool FluidSimProc::SaveStage( const char *path, ThreadPool *pool )
+{
+	if ( m_scalar eqt SCALAR_FLOAT ) return SaveCurStage( m_ffields, m_fnodes, path, pool );
+	else                             return SaveCurStage( m_dfields, m_dnodes, path, pool );
+};
+
+
+template <typename T>
+bool FluidSimProc::SaveCurStage( FIELDS<T> &f, vector< FIELDS<T> > &nodes, const char *path, ThreadPool *pool )
+{
+	/* the slot table in front of the fields tells which bricks they hold */
+	const size_t elements = m_grid.Elements();
+	cint bricks = ( m_grid.storage eqt STORAGE_SPARSE ) ? m_grid.map->Size() : 0;
+
+	/* the interpolated subnodes are made anew from the grid every step */
+	cint count = ( m_sync eqt NODES_EXCHANGE ) ? (int)nodes.size() : 0;
+	const size_t nodeelements = count ? m_node.Elements() : 0;
+
+	size_t active = 0;
+	for ( int n = 0; n < count; n++ ) if ( m_active[n] ) active++;
+
+	const size_t data = ( sizeof(SNAPSHOT) + bricks * sizeof(int) + count + SNAPSHOT_ALIGN - 1 ) / SNAPSHOT_ALIGN * SNAPSHOT_ALIGN;
+	const size_t size = data + SNAPSHOT_FIELDS * ( elements + active * nodeelements ) * sizeof(T);
+
+	MappedFile file;
+	if ( not file.Create( path, size ) ) return false;
+
+	SNAPSHOT *head = (SNAPSHOT*) file.Data();
+	memset( head, 0, sizeof(SNAPSHOT) );
+	memcpy( head->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC) );
+	head->version = SNAPSHOT_VERSION;
+
+	head->nx = m_grid.nx; head->ny = m_grid.ny; head->nz = m_grid.nz; head->halo = m_grid.halo;
+	head->storage = m_grid.storage;
+	head->scalar  = m_scalar;
+
+	head->steps = m_steps;
+	head->times = m_times;
+
+	head->relax = m_relax; head->pressure = m_pressure; head->depth = m_depth;
+	head->maxcycles = m_maxcycles; head->cycles = m_cycles;
+	head->tolerance = m_tolerance; head->residual = m_residual;
+
+	head->fields   = SNAPSHOT_FIELDS;
+	head->bricks   = bricks;
+	head->slots    = bricks ? m_grid.map->Slots() : 0;
+	head->nodes    = count;
+	head->elements = (long long)elements;
+	head->nodeelements = (long long)nodeelements;
+	head->data     = (long long)data;
+
+	if ( bricks ) memcpy( head + 1, m_grid.map->SlotTable(), bricks * sizeof(int) );
+	if ( count ) memcpy( (char*)( head + 1 ) + bricks * sizeof(int), &m_active[0], count );
+
+	char *out = (char*)file.Data() + data;
+	out = SaveFields( pool, out, f, elements );
+
+	for ( int n = 0; n < count; n++ )
+		if ( m_active[n] ) out = SaveFields( pool, out, nodes[n], nodeelements );
+
+	return true;
+};
+
+
+template <typename T>
+bool FluidSimProc::LoadPreStage( FIELDS<T> &f, vector< FIELDS<T> > &nodes, const char *path )
+{
+	MappedFile file;
+	if ( not file.Open( path ) ) return false;
+
+	const SNAPSHOT *head = (const SNAPSHOT*) file.Data();
+	if ( file.Size() < sizeof(SNAPSHOT) or memcmp( head->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC) ) not_eq 0 )
+	{
+		printf( "%s is not a snapshot\n", path );
+		return false;
+	}
+
+	/* the fields are copied as they are, so everything deciding their layout must match */
+	if ( head->version not_eq SNAPSHOT_VERSION or head->fields not_eq SNAPSHOT_FIELDS or
+		head->nx not_eq m_grid.nx or head->ny not_eq m_grid.ny or head->nz not_eq m_grid.nz or
+		head->halo not_eq m_grid.halo or head->storage not_eq m_grid.storage or head->scalar not_eq m_scalar )
+	{
+		printf( "%s holds a %dx%dx%d grid of storage %d and precision %d, version %d, the solver does not\n",
+			path, head->nx, head->ny, head->nz, head->storage, head->scalar, head->version );
+		return false;
+	}
+
+	const bool sparse = ( m_grid.storage eqt STORAGE_SPARSE );
+	const size_t elements = (size_t)head->elements, nodeelements = (size_t)head->nodeelements;
+	const char *active = (const char*)( head + 1 ) + head->bricks * sizeof(int);
+
+	bool damaged = ( (size_t)head->data < sizeof(SNAPSHOT) + head->bricks * sizeof(int) + head->nodes or
+		file.Size() < (size_t)head->data );
+
+	size_t solved = 0;
+	for ( int n = 0; n < head->nodes and not damaged; n++ ) if ( active[n] ) solved++;
+
+	if ( damaged or
+		( sparse and ( head->bricks not_eq m_grid.map->Size() or elements not_eq (size_t)head->slots * BRICK_CELLS ) ) or
+		( not sparse and elements not_eq m_grid.Elements() ) or
+		file.Size() < (size_t)head->data + SNAPSHOT_FIELDS * ( elements + solved * nodeelements ) * sizeof(T) )
+	{
+		printf( "%s is truncated or damaged\n", path );
+		return false;
+	}
+
+	/* the bricks of a sparse grid first, div and tmp are resized along */
+	if ( sparse )
+	{
+		T *fields[] = { f.den, f.u, f.v, f.w, f.den0, f.u0, f.v0, f.w0, f.p, f.obs, f.div, f.tmp };
+
+		bool restored = m_grid.map->Restore( fields, 12, (const int*)( head + 1 ), head->slots );
+
+		f.den = fields[0]; f.u  = fields[1]; f.v  = fields[2]; f.w  = fields[3];
+		f.den0 = fields[4]; f.u0 = fields[5]; f.v0 = fields[6]; f.w0 = fields[7];
+		f.p = fields[8]; f.obs = fields[9]; f.div = fields[10]; f.tmp = fields[11];
+
+		if ( not restored ) return false;
+	}
+
+	const char *in = (const char*)file.Data() + head->data;
+	in = LoadFields( &m_pool, in, f, elements );
+
+	/* the subnodes kept by NODES_EXCHANGE, if the solver keeps the same ones, *
+	 * else they start over from the grid, as on the first step                */
+	const bool keep = ( m_sync eqt NODES_EXCHANGE and head->nodes eqt (int)nodes.size() and
+		head->nodes > 0 and nodeelements eqt m_node.Elements() );
+
+	m_active.assign( m_active.size(), 0 );
+	for ( int n = 0; n < head->nodes and keep; n++ )
+	{
+		if ( not active[n] ) continue;
+
+		in = LoadFields( &m_pool, in, nodes[n], nodeelements );
+		m_active[n] = 1;
+	}
+
+	m_steps = head->steps;
+	m_times = head->times;
+
+	m_relax = (RELAXATION)head->relax;
+	m_depth = head->depth;
+	SetPressureSolver( (PRESSURESOLVER)head->pressure, head->tolerance, head->maxcycles );
+	m_cycles   = head->cycles;
+	m_residual = head->residual;
+
+	return true;
+};
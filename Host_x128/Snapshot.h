@@ -0,0 +1,91 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Snapshot.h
+*/
+
+#ifndef __snapshot_h_
+#define __snapshot_h_
+
+#include <stddef.h>
+#include "ISO646.h"
+
+/* first bytes of a snapshot, and the version of the layout below */
+#define SNAPSHOT_MAGIC   "SGESNAP"
+#define SNAPSHOT_VERSION 1
+
+/* the fields start on a page, so that they are copied page after page */
+#define SNAPSHOT_ALIGN   4096
+
+namespace sge
+{
+	/* head of a snapshot of FluidSimProc, followed by the slot table of a sparse *
+	 * grid and the active flags of the subnodes, if any, and at offset data by   *
+	 * the fields, each of elements cells in the storage order of the grid, ghosts *
+	 * included, one after the other, then those of each active subnode            */
+	struct SNAPSHOT
+	{
+		char magic[8];
+		int  version;
+
+		/* the grid and the storage of its fields */
+		int nx, ny, nz, halo;
+		int storage, scalar;
+
+		/* steps solved, and cells fed by the source, which stops after a few */
+		int steps, times;
+
+		/* the solver it was taken with */
+		int relax, pressure, depth, maxcycles, cycles;
+		double tolerance, residual;
+
+		/* fields and cells of each, bricks and slots of a sparse grid, and the *
+		 * subnodes kept by NODES_EXCHANGE and the cells of each of their fields */
+		int fields, bricks, slots, nodes;
+		long long elements, nodeelements;
+		long long data;
+	};
+
+
+	/* a file mapped into memory whole, created at a given size for writing, or *
+	 * opened as it is for reading; the pages are filled from the page cache on *
+	 * first touch instead of going through a buffer of the stdio                 */
+	class MappedFile
+	{
+	private:
+		void  *m_data;
+		size_t m_size;
+
+#if defined(_WIN32)
+		void *m_file, *m_mapping;
+#else
+		int m_fd;
+#endif
+
+	public:
+		MappedFile( void );
+
+		~MappedFile( void ) { Close(); };
+
+	public:
+		/* a new file of size bytes, an existing one is truncated */
+		bool Create( const char *path, const size_t size );
+
+		/* an existing file, read only */
+		bool Open( const char *path );
+
+		void Close( void );
+
+		void *Data( void ) const { return m_data; };
+
+		size_t Size( void ) const { return m_size; };
+
+	private:
+		MappedFile( const MappedFile& );
+		MappedFile &operator=( const MappedFile& );
+	};
+};
+
+#endif
@@ -0,0 +1,65 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     StopWatch.h
+*/
+
+#ifndef __stop_watch_h_
+#define __stop_watch_h_
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <Windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace sge
+{
+	/* monotonic, high resolution wall clock; clock() counts CPU time of the *
+	 * whole process and GetTickCount only ticks every 10~16 ms              */
+	class StopWatch
+	{
+	private:
+		double m_start;
+
+	public:
+		StopWatch( void ) { Start(); };
+
+	public:
+		/* seconds elapsed since an arbitrary, fixed point in the past */
+		static double Now( void )
+		{
+#if defined(_WIN32)
+			LARGE_INTEGER freq, count;
+			QueryPerformanceFrequency( &freq );
+			QueryPerformanceCounter( &count );
+			return (double)count.QuadPart / (double)freq.QuadPart;
+#else
+			struct timespec ts;
+			clock_gettime( CLOCK_MONOTONIC, &ts );
+			return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+		};
+
+		void Start( void ) { m_start = Now(); };
+
+		/* seconds elapsed since the last Start */
+		double Elapsed( void ) const { return Now() - m_start; };
+
+		/* same as Elapsed, but restart the watch as well */
+		double Lap( void )
+		{
+			double now = Now();
+			double lap = now - m_start;
+			m_start = now;
+			return lap;
+		};
+	};
+};
+
+#endif
@@ -0,0 +1,354 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Suite.cpp
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "MacroDefinition.h"
+#include "FluidSimProc.h"
+#include "StopWatch.h"
+
+using namespace sge;
+using std::vector;
+using std::string;
+
+#define STAGE_SOURCE     0
+#define STAGE_VELOCITY   1
+#define STAGE_PROJECTION 2
+#define STAGE_DENSITY    3
+#define STAGE_VOLUME     4
+#define STAGE_STEP       5
+#define STAGES           6
+
+/* the projections are timed within velocity, step is the sum of the others */
+static const char *t_stagename[STAGES] = { "source", "velocity", "projection", "density", "volume", "step" };
+
+static const char *t_scalarname[] = { "double", "float" };
+static const char *t_storagename[] = { "rows", "bricks", "sparse" };
+static const char *t_pressurename[] = { "jacobi", "vcycle", "fmg" };
+static const char *t_simdname[] = { "scalar", "avx2", "avx512" };
+
+
+/* milliseconds of one stage over the timed steps of a run */
+struct STATS
+{
+	double median, p95, mean, min, max;
+};
+
+
+/* one grid, thread count and precision of the suite */
+struct RUN
+{
+	int nx, ny, nz, threads;
+	SCALAR scalar;
+	STATS stage[STAGES];
+
+	/* the density summed after the last step, equal for equal work */
+	double checksum;
+};
+
+
+static void Usage( const char *app )
+{
+	printf( "usage: %s [-g n[,n...]] [-t threads[,threads...]] [-s double|float[,...]] [-w warmup]\n"
+		"       [-n steps] [-p jacobi|vcycle|fmg] [-l rows|bricks|sparse]\n"
+		"       [-i scalar|avx2|avx512] [-j file.json] [-c file.csv]\n"
+		"  -g  cubic grid extents to run, default 64,128\n"
+		"  -t  thread counts to run, 0 for one per core, default 1,0\n"
+		"  -s  storage precisions to run, default double\n"
+		"  -w  steps run before the timing starts, default 3\n"
+		"  -n  steps timed, each one a sample of every stage, default 10\n"
+		"  -p  pressure solver of the projection, default jacobi\n"
+		"  -l  storage order of the fields, default rows\n"
+		"  -i  instruction set of the stencils, default the widest the CPU supports\n"
+		"  -j  write the results as JSON\n"
+		"  -c  write the results as CSV, a line per run and stage\n"
+		"every stage is deterministic, the same settings do the same work in every run\n",
+		app );
+};
+
+
+/* the comma separated values of a list argument */
+static vector<string> Split( const char *list )
+{
+	vector<string> items;
+	string item;
+
+	for ( const char *c = list; ; c++ )
+	{
+		if ( *c eqt ',' or *c eqt '\0' )
+		{
+			if ( not item.empty() ) items.push_back( item );
+			item.clear();
+			if ( *c eqt '\0' ) break;
+		}
+		else item += *c;
+	}
+
+	return items;
+};
+
+
+/* nearest rank percentiles, which are samples that were measured */
+static STATS Statistics( vector<double> samples )
+{
+	STATS stats = { 0.f, 0.f, 0.f, 0.f, 0.f };
+	if ( samples.empty() ) return stats;
+
+	std::sort( samples.begin(), samples.end() );
+	cint n = (int)samples.size();
+
+	double sum = 0.f;
+	for ( int i = 0; i < n; i++ ) sum += samples[i];
+
+	stats.median = ( n % 2 ) ? samples[n / 2] : 0.5 * ( samples[n / 2 - 1] + samples[n / 2] );
+	stats.p95    = samples[ ( 95 * n + 99 ) / 100 - 1 ];
+	stats.mean   = sum / n;
+	stats.min    = samples[0];
+	stats.max    = samples[n - 1];
+
+	return stats;
+};
+
+
+/* a fresh solver warmed up, then timed stage by stage for steps steps */
+static RUN Measure( cint n, cint threads, const SCALAR scalar, const STORAGE storage, const PRESSURESOLVER pressure,
+	const SIMD simd, cint warmup, cint steps )
+{
+	RUN run;
+	run.nx = run.ny = run.nz = n;
+	run.scalar = scalar;
+
+	FLUIDSPARAM fluid;
+	fluid.run = true;
+	fluid.volume.ptrData = NULL;
+
+	FluidSimProc *simproc = new FluidSimProc( &fluid, n, n, n, scalar, storage );
+	simproc->SetThreads( threads );
+	simproc->SetSimd( simd );
+	simproc->SetPressureSolver( pressure );
+	run.threads = simproc->GetThreads();
+
+	vector<double> samples[STAGES];
+	StopWatch watch;
+
+	for ( int s = 0; s < warmup + steps; s++ )
+	{
+		double step[STAGES];
+
+		watch.Start();
+		simproc->SourceSolver( DELTATIME );
+		step[STAGE_SOURCE] = watch.Lap();
+
+		double projected = simproc->GetProjectionTime();
+		simproc->VelocitySolver( DELTATIME );
+		step[STAGE_VELOCITY] = watch.Lap();
+		step[STAGE_PROJECTION] = simproc->GetProjectionTime() - projected;
+
+		simproc->DensitySolver( DELTATIME );
+		step[STAGE_DENSITY] = watch.Lap();
+
+		simproc->GenerVolumeImg();
+		simproc->RefreshStatus( &fluid );
+		step[STAGE_VOLUME] = watch.Lap();
+
+		step[STAGE_STEP] = step[STAGE_SOURCE] + step[STAGE_VELOCITY] + step[STAGE_DENSITY] + step[STAGE_VOLUME];
+
+		if ( s < warmup ) continue;
+		for ( int i = 0; i < STAGES; i++ ) samples[i].push_back( step[i] * 1000.0 );
+	}
+
+	for ( int i = 0; i < STAGES; i++ ) run.stage[i] = Statistics( samples[i] );
+	run.checksum = simproc->ReduceDensity( REDUCE_SUM );
+
+	simproc->FreeResource();
+	delete simproc;
+
+	return run;
+};
+
+
+static void WriteJson( const char *path, const vector<RUN> &runs, const STORAGE storage, const PRESSURESOLVER pressure,
+	const SIMD simd, cint warmup, cint steps )
+{
+	FILE *file = fopen( path, "w" );
+	if ( file eqt NULL ) { printf( "open %s failed\n", path ); return; }
+
+	fprintf( file, "{\n  \"deterministic\": true,\n  \"warmup\": %d,\n  \"steps\": %d,\n", warmup, steps );
+	fprintf( file, "  \"storage\": \"%s\",\n  \"pressure\": \"%s\",\n  \"simd\": \"%s\",\n",
+		t_storagename[storage], t_pressurename[pressure], t_simdname[simd] );
+	fprintf( file, "  \"runs\": [\n" );
+
+	for ( size_t r = 0; r < runs.size(); r++ )
+	{
+		const RUN &run = runs[r];
+
+		fprintf( file, "    {\n      \"grid\": [%d, %d, %d],\n      \"threads\": %d,\n      \"scalar\": \"%s\",\n",
+			run.nx, run.ny, run.nz, run.threads, t_scalarname[run.scalar] );
+		fprintf( file, "      \"checksum\": %.17g,\n      \"stages\": {\n", run.checksum );
+
+		for ( int i = 0; i < STAGES; i++ )
+		{
+			const STATS &s = run.stage[i];
+			fprintf( file, "        \"%s\": { \"median_ms\": %.6f, \"p95_ms\": %.6f, \"mean_ms\": %.6f, "
+				"\"min_ms\": %.6f, \"max_ms\": %.6f }%s\n", t_stagename[i], s.median, s.p95, s.mean, s.min, s.max,
+				( i + 1 < STAGES ) ? "," : "" );
+		}
+
+		fprintf( file, "      }\n    }%s\n", ( r + 1 < runs.size() ) ? "," : "" );
+	}
+
+	fprintf( file, "  ]\n}\n" );
+	fclose( file );
+};
+
+
+static void WriteCsv( const char *path, const vector<RUN> &runs )
+{
+	FILE *file = fopen( path, "w" );
+	if ( file eqt NULL ) { printf( "open %s failed\n", path ); return; }
+
+	fprintf( file, "nx,ny,nz,threads,scalar,stage,median_ms,p95_ms,mean_ms,min_ms,max_ms,mcells_s,checksum\n" );
+
+	for ( size_t r = 0; r < runs.size(); r++ )
+	{
+		const RUN &run = runs[r];
+		double cells = (double)( run.nx - 2 ) * ( run.ny - 2 ) * ( run.nz - 2 ) / 1e6;
+
+		for ( int i = 0; i < STAGES; i++ )
+		{
+			const STATS &s = run.stage[i];
+			fprintf( file, "%d,%d,%d,%d,%s,%s,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%.17g\n", run.nx, run.ny, run.nz,
+				run.threads, t_scalarname[run.scalar], t_stagename[i], s.median, s.p95, s.mean, s.min, s.max,
+				( s.median > 0.f ) ? cells / s.median * 1000.0 : 0.f, run.checksum );
+		}
+	}
+
+	fclose( file );
+};
+
+
+/* every stage of the solver over a matrix of grids, thread counts and precisions, *
+ * each run from a fresh solver, whose stages are deterministic, so that runs of   *
+ * two builds are timed on the same work and can be compared number by number      */
+int main( int argc, char **argv )
+{
+	vector<int> grids, threads;
+	vector<SCALAR> scalars;
+	int warmup = 3, steps = 10;
+	PRESSURESOLVER pressure = PRESSURE_JACOBI;
+	STORAGE storage = STORAGE_ROWS;
+	SIMD simd = DetectSimd();
+	const char *json = NULL, *csv = NULL;
+
+	for ( int i = 1; i < argc; i++ )
+	{
+		string opt = argv[i];
+		const char *val = ( i + 1 < argc ) ? argv[i + 1] : NULL;
+
+		if ( val eqt NULL ) { Usage( argv[0] ); return 1; }
+
+		if ( opt eqt "-w" ) warmup = atoi( val );
+		elif ( opt eqt "-n" ) steps = atoi( val );
+		elif ( opt eqt "-j" ) json = val;
+		elif ( opt eqt "-c" ) csv = val;
+		elif ( opt eqt "-g" or opt eqt "-t" )
+		{
+			vector<string> items = Split( val );
+			for ( size_t n = 0; n < items.size(); n++ )
+				( opt eqt "-g" ? grids : threads ).push_back( atoi( items[n].c_str() ) );
+		}
+		elif ( opt eqt "-s" )
+		{
+			vector<string> items = Split( val );
+			for ( size_t n = 0; n < items.size(); n++ )
+			{
+				if ( items[n] eqt "double" ) scalars.push_back( SCALAR_DOUBLE );
+				elif ( items[n] eqt "float" ) scalars.push_back( SCALAR_FLOAT );
+				else { Usage( argv[0] ); return 1; }
+			}
+		}
+		elif ( opt eqt "-p" )
+		{
+			string mode = val;
+			if ( mode eqt "jacobi" ) pressure = PRESSURE_JACOBI;
+			elif ( mode eqt "vcycle" ) pressure = PRESSURE_VCYCLE;
+			elif ( mode eqt "fmg" ) pressure = PRESSURE_FMG;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-l" )
+		{
+			string mode = val;
+			if ( mode eqt "rows" ) storage = STORAGE_ROWS;
+			elif ( mode eqt "bricks" ) storage = STORAGE_BRICKS;
+			elif ( mode eqt "sparse" ) storage = STORAGE_SPARSE;
+			else { Usage( argv[0] ); return 1; }
+		}
+		elif ( opt eqt "-i" )
+		{
+			string mode = val;
+			if ( mode eqt "scalar" ) simd = SIMD_SCALAR;
+			elif ( mode eqt "avx2" ) simd = SIMD_AVX2;
+			elif ( mode eqt "avx512" ) simd = SIMD_AVX512;
+			else { Usage( argv[0] ); return 1; }
+		}
+		else { Usage( argv[0] ); return 1; }
+
+		i++;
+	}
+
+	if ( grids.empty() ) { grids.push_back( 64 ); grids.push_back( 128 ); }
+	if ( threads.empty() ) { threads.push_back( 1 ); threads.push_back( 0 ); }
+	if ( scalars.empty() ) scalars.push_back( SCALAR_DOUBLE );
+
+	if ( warmup < 0 or steps <= 0 )
+	{
+		Usage( argv[0] );
+		return 1;
+	}
+	for ( size_t g = 0; g < grids.size(); g++ ) if ( grids[g] < 3 ) { Usage( argv[0] ); return 1; }
+
+	/* the instruction set actually used, bricks and sparse fields run scalar */
+	if ( simd > DetectSimd() ) simd = DetectSimd();
+	if ( storage not_eq STORAGE_ROWS ) simd = SIMD_SCALAR;
+	if ( storage eqt STORAGE_SPARSE ) pressure = PRESSURE_JACOBI;
+
+	vector<RUN> runs;
+
+	for ( size_t g = 0; g < grids.size(); g++ )
+	for ( size_t s = 0; s < scalars.size(); s++ )
+	for ( size_t t = 0; t < threads.size(); t++ )
+		runs.push_back( Measure( grids[g], threads[t], scalars[s], storage, pressure, simd, warmup, steps ) );
+
+	printf( "\n%-12s %-7s %-7s %-11s %11s %11s %11s %11s\n", "grid", "threads", "scalar", "stage",
+		"median(ms)", "p95(ms)", "mean(ms)", "Mcells/s" );
+
+	for ( size_t r = 0; r < runs.size(); r++ )
+	{
+		const RUN &run = runs[r];
+		double cells = (double)( run.nx - 2 ) * ( run.ny - 2 ) * ( run.nz - 2 ) / 1e6;
+		/* three ints of at most 11 characters each */
+		char grid[40];
+		sprintf( grid, "%dx%dx%d", run.nx, run.ny, run.nz );
+
+		for ( int i = 0; i < STAGES; i++ )
+		{
+			const STATS &st = run.stage[i];
+			printf( "%-12s %-7d %-7s %-11s %11.3f %11.3f %11.3f %11.1f\n", grid, run.threads, t_scalarname[run.scalar],
+				t_stagename[i], st.median, st.p95, st.mean, ( st.median > 0.f ) ? cells / st.median * 1000.0 : 0.f );
+		}
+		printf( "%-12s %-7d %-7s %-11s %.17g\n", grid, run.threads, t_scalarname[run.scalar], "checksum", run.checksum );
+	}
+
+	if ( json not_eq NULL ) WriteJson( json, runs, storage, pressure, simd, warmup, steps );
+	if ( csv not_eq NULL ) WriteCsv( csv, runs );
+
+	return 0;
+};
@@ -0,0 +1,259 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     ThreadPool.cpp
+*/
+
+#include "ThreadPool.h"
+
+using namespace sge;
+
+/* the pool and the thread of it running on this thread, if any, and the *
+ * number of tasks this thread is in the middle of                        */
+static THREAD_LOCAL const ThreadPool *t_pool = NULL;
+static THREAD_LOCAL int t_thread = 0;
+static THREAD_LOCAL int t_tasks = 0;
+
+
+ThreadPool::ThreadPool( cint threads )
+	: m_first(0), m_last(0), m_chunks(1), m_generation(0), m_pending(0), m_quit(false), m_csr(0), m_queued(0)
+{
+	Start( threads );
+};
+
+
+ThreadPool::~ThreadPool( void )
+{
+	Stop();
+};
+
+
+int ThreadPool::HardwareThreads( void )
+{
+	int n = (int)std::thread::hardware_concurrency();
+	return ( n > 0 ) ? n : 1;
+};
+
+
+void ThreadPool::Start( cint threads )
+{
+	int n = ( threads > 0 ) ? threads : HardwareThreads();
+
+	m_quit = false;
+	m_deques.reset( new DEQUE[n] );
+	for ( int i = 1; i < n; i++ )
+		m_workers.push_back( std::thread( &ThreadPool::WorkerLoop, this, i ) );
+};
+
+
+void ThreadPool::Stop( void )
+{
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_quit = true;
+	}
+	m_wake.notify_all();
+
+	for ( size_t i = 0; i < m_workers.size(); i++ ) m_workers[i].join();
+	m_workers.clear();
+};
+
+
+void ThreadPool::Resize( cint threads )
+{
+	int n = ( threads > 0 ) ? threads : HardwareThreads();
+	if ( n eqt Threads() ) return;
+
+	Stop();
+	Start( n );
+};
+
+
+void ThreadPool::Chunk( cint first, cint last, cint chunks, cint id, int &begin, int &end )
+{
+	/* chunk id of chunks, the first chunks take one more item if uneven */
+	int count = last - first;
+	int base  = count / chunks;
+	int extra = count % chunks;
+
+	begin = first + id * base + ( id < extra ? id : extra );
+	end   = begin + base + ( id < extra ? 1 : 0 );
+};
+
+
+void ThreadPool::RunChunk( cint id )
+{
+	int begin, end;
+	Chunk( m_first, m_last, m_chunks, id, begin, end );
+
+	if ( begin < end ) m_job( begin, end );
+};
+
+
+int ThreadPool::Self( void ) const
+{
+	return ( t_pool eqt this ) ? t_thread : 0;
+};
+
+
+bool ThreadPool::RunTask( cint id )
+{
+	cint threads = Threads();
+	TASK task;
+	bool found = false;
+
+	/* our own deque first, then the others in turn */
+	for ( int n = 0; n < threads and not found; n++ )
+	{
+		DEQUE &deque = m_deques[ ( id + n ) % threads ];
+		std::unique_lock<std::mutex> lock( deque.mutex );
+
+		if ( deque.tasks.empty() ) continue;
+
+		if ( n eqt 0 )
+		{
+			task = deque.tasks.back();
+			deque.tasks.pop_back();
+		}
+		else
+		{
+			task = deque.tasks.front();
+			deque.tasks.pop_front();
+		}
+		found = true;
+	}
+
+	if ( not found ) return false;
+	m_queued--;
+
+	unsigned int csr = GetFloatControl();
+	SetFloatControl( task.csr );
+
+	t_tasks++;
+	task.run();
+	t_tasks--;
+
+	SetFloatControl( csr );
+	task.group->m_pending--;
+
+	return true;
+};
+
+
+void ThreadPool::Spawn( TaskGroup &group, const std::function<void( void )> &task )
+{
+	TASK item = { task, &group, GetFloatControl() };
+	group.m_pending++;
+
+	{
+		DEQUE &deque = m_deques[ Self() ];
+		std::unique_lock<std::mutex> lock( deque.mutex );
+		deque.tasks.push_back( item );
+	}
+
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_queued++;
+	}
+	m_wake.notify_one();
+};
+
+
+void ThreadPool::Wait( TaskGroup &group )
+{
+	cint id = Self();
+
+	/* help out instead of blocking, the last tasks may be running elsewhere */
+	while ( group.m_pending > 0 )
+		if ( not RunTask( id ) ) std::this_thread::yield();
+};
+
+
+void ThreadPool::WorkerLoop( cint id )
+{
+	int seen = 0;
+
+	t_pool   = this;
+	t_thread = id;
+
+	while ( true )
+	{
+		bool chunk = false;
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			while ( not m_quit and m_generation eqt seen and m_queued eqt 0 ) m_wake.wait( lock );
+			if ( m_quit ) return;
+			if ( m_generation not_eq seen ) { seen = m_generation; chunk = true; }
+		}
+
+		/* woken for the tasks, which another thread may have taken already */
+		if ( not chunk )
+		{
+			RunTask( id );
+			continue;
+		}
+
+		SetFloatControl( m_csr );
+		RunChunk( id );
+
+		{
+			std::unique_lock<std::mutex> lock( m_mutex );
+			if ( --m_pending eqt 0 ) m_done.notify_one();
+		}
+	}
+};
+
+
+void ThreadPool::ParallelFor( cint first, cint last, const std::function<void( int, int )> &job )
+{
+	if ( last <= first ) return;
+
+	/* nothing to share, run on the calling thread */
+	if ( m_workers.empty() or last - first eqt 1 )
+	{
+		job( first, last );
+		return;
+	}
+
+	/* the workers may all be busy with other tasks, so the chunks are left for *
+	 * whichever thread gets to them first, the first one for this thread      */
+	if ( t_tasks > 0 )
+	{
+		TaskGroup group;
+		cint chunks = ( last - first < Threads() ) ? last - first : Threads();
+		int begin, end;
+
+		for ( int c = chunks - 1; c > 0; c-- )
+		{
+			Chunk( first, last, chunks, c, begin, end );
+			Spawn( group, [&job, begin, end]( void ) { job( begin, end ); } );
+		}
+
+		Chunk( first, last, chunks, 0, begin, end );
+		job( begin, end );
+
+		Wait( group );
+		return;
+	}
+
+	{
+		std::unique_lock<std::mutex> lock( m_mutex );
+		m_job     = job;
+		m_first   = first;
+		m_last    = last;
+		m_chunks  = Threads();
+		m_csr     = GetFloatControl();
+		m_pending = (int)m_workers.size();
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	/* the caller works on the first chunk */
+	RunChunk( 0 );
+
+	std::unique_lock<std::mutex> lock( m_mutex );
+	while ( m_pending > 0 ) m_done.wait( lock );
+	m_job = nullptr;
+};
@@ -0,0 +1,123 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     ThreadPool.h
+*/
+
+#ifndef __thread_pool_h_
+#define __thread_pool_h_
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "FloatControl.h"
+#include "ISO646.h"
+
+namespace sge
+{
+	/* tasks spawned into a ThreadPool, to be waited for together */
+	class TaskGroup
+	{
+		friend class ThreadPool;
+
+	private:
+		std::atomic<int> m_pending;
+
+	public:
+		TaskGroup( void ) : m_pending(0) {};
+	};
+
+
+	/* a fixed set of worker threads which stay alive between calls, so that *
+	 * splitting one sweep of a stencil over the cores costs only a wake-up   */
+	class ThreadPool
+	{
+	private:
+		std::vector<std::thread> m_workers;
+		std::mutex m_mutex;
+		std::condition_variable m_wake, m_done;
+
+		std::function<void( int, int )> m_job;
+		int m_first, m_last, m_chunks;
+		int m_generation, m_pending;
+		bool m_quit;
+
+		/* the workers run the job with the floating point mode of the caller */
+		unsigned int m_csr;
+
+		/* a spawned task, run with the floating point mode of its spawner */
+		struct TASK
+		{
+			std::function<void( void )> run;
+			TaskGroup *group;
+			unsigned int csr;
+		};
+
+		/* the tasks of each thread, the caller's first; the owner takes the newest, *
+		 * which are the smallest pieces of its work, the others steal the oldest    */
+		struct DEQUE
+		{
+			std::mutex mutex;
+			std::deque<TASK> tasks;
+		};
+
+		std::unique_ptr<DEQUE[]> m_deques;
+
+		/* tasks in all deques, only raised under m_mutex so no worker misses one */
+		std::atomic<int> m_queued;
+
+	public:
+		/* threads < 1 means one thread per hardware core */
+		explicit ThreadPool( cint threads = 0 );
+
+		~ThreadPool( void );
+
+	public:
+		/* number of threads taking part in a ParallelFor, the caller included */
+		int Threads( void ) const { return (int)m_workers.size() + 1; };
+
+		void Resize( cint threads );
+
+		/* split [first, last) into one contiguous chunk per thread, and call  *
+		 * job( begin, end ) for each of them, returns when all chunks are done; *
+		 * within a task the chunks become tasks themselves, for idle threads to *
+		 * steal, so a task can split its own stages further                     */
+		void ParallelFor( cint first, cint last, const std::function<void( int, int )> &job );
+
+		/* queue task in group on the deque of the calling thread, for any thread of *
+		 * the pool to run; groups may be nested, a task may spawn and wait itself   */
+		void Spawn( TaskGroup &group, const std::function<void( void )> &task );
+
+		/* run the tasks of the pool, stealing from the other threads when short, *
+		 * until all tasks of group are done                                      */
+		void Wait( TaskGroup &group );
+
+		static int HardwareThreads( void );
+
+	private:
+		void Start( cint threads );
+
+		void Stop( void );
+
+		void WorkerLoop( cint id );
+
+		void RunChunk( cint id );
+
+		/* run one task, the newest of thread id or the oldest of another, false if none */
+		bool RunTask( cint id );
+
+		/* thread of the pool calling, 0 for the threads outside it */
+		int Self( void ) const;
+
+		static void Chunk( cint first, cint last, cint chunks, cint id, int &begin, int &end );
+	};
+};
+
+#endif
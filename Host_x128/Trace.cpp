@@ -0,0 +1,156 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Trace.cpp
+*/
+
+#include <stdio.h>
+#include <vector>
+#include <string>
+#include <atomic>
+#include <mutex>
+#include "Trace.h"
+
+using namespace sge;
+using std::vector;
+using std::string;
+
+/* the events of a thread, head counts every event it ever recorded, so the *
+ * last TRACE_EVENTS of them are at head - TRACE_EVENTS .. head - 1          */
+struct TRACERING
+{
+	std::atomic<unsigned long long> head;
+	vector<TRACEEVENT> events;
+	int tid;
+	string name;
+};
+
+/* the rings of all threads, kept after their threads end, as their events *
+ * still belong to the trace                                               */
+static std::mutex t_mutex;
+static vector<TRACERING*> t_rings;
+
+static std::atomic<bool> t_enabled( false );
+static double t_origin = 0.f;
+
+static THREAD_LOCAL TRACERING *t_ring = NULL;
+
+
+/* the ring of the calling thread, created on its first event */
+static TRACERING *Ring( void )
+{
+	if ( t_ring not_eq NULL ) return t_ring;
+
+	TRACERING *ring = new TRACERING;
+	ring->head = 0;
+	ring->events.resize( TRACE_EVENTS );
+
+	std::lock_guard<std::mutex> lock( t_mutex );
+	ring->tid  = (int)t_rings.size() + 1;
+	ring->name = "thread " + std::to_string( ring->tid );
+	t_rings.push_back( ring );
+
+	return t_ring = ring;
+};
+
+
+void Tracer::Enable( const bool on )
+{
+	/* the timeline starts when first enabled */
+	if ( on and t_origin <= 0.f ) t_origin = StopWatch::Now();
+
+	t_enabled.store( on, std::memory_order_release );
+};
+
+
+bool Tracer::Enabled( void )
+{
+	return t_enabled.load( std::memory_order_relaxed );
+};
+
+
+void Tracer::NameThread( const char *name )
+{
+	TRACERING *ring = Ring();
+
+	std::lock_guard<std::mutex> lock( t_mutex );
+	ring->name = name;
+};
+
+
+void Tracer::Record( const char *name, cdouble begin, cdouble end, cint arg )
+{
+	TRACERING *ring = Ring();
+
+	/* only this thread writes the ring, Dump learns of the event by head */
+	unsigned long long n = ring->head.load( std::memory_order_relaxed );
+	TRACEEVENT &event = ring->events[ n % TRACE_EVENTS ];
+
+	event.name  = name;
+	event.begin = begin;
+	event.end   = end;
+	event.arg   = arg;
+
+	ring->head.store( n + 1, std::memory_order_release );
+};
+
+
+bool Tracer::Dump( const char *path )
+{
+	FILE *file = fopen( path, "w" );
+	if ( file eqt NULL )
+	{
+		printf( "write trace to %s failed\n", path );
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock( t_mutex );
+
+	fprintf( file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+	int count = 0;
+	for ( size_t r = 0; r < t_rings.size(); r++ )
+	{
+		TRACERING *ring = t_rings[r];
+
+		fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+			( r > 0 ) ? ",\n" : "", ring->tid, ring->name.c_str() );
+		fprintf( file, ",\n{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"sort_index\":%d}}",
+			ring->tid, ring->tid );
+
+		/* copy what the ring holds, then keep only the events the thread cannot have *
+		 * overwritten meanwhile; the slot of head - TRACE_EVENTS may be the one it is *
+		 * writing                                                                     */
+		unsigned long long last  = ring->head.load( std::memory_order_acquire );
+		unsigned long long first = ( last > TRACE_EVENTS ) ? last - TRACE_EVENTS : 0;
+
+		vector<TRACEEVENT> events( (size_t)( last - first ) );
+		for ( unsigned long long n = first; n < last; n++ ) events[ n - first ] = ring->events[ n % TRACE_EVENTS ];
+
+		unsigned long long head = ring->head.load( std::memory_order_acquire );
+		if ( head + 1 > first + TRACE_EVENTS ) first = head + 1 - TRACE_EVENTS;
+
+		for ( unsigned long long n = first; n < last; n++ )
+		{
+			const TRACEEVENT &event = events[ n - ( last - events.size() ) ];
+
+			fprintf( file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+				event.name, ring->tid, ( event.begin - t_origin ) * 1e6, ( event.end - event.begin ) * 1e6 );
+
+			if ( event.arg >= 0 ) fprintf( file, ",\"args\":{\"step\":%d}", event.arg );
+			fprintf( file, "}" );
+
+			count++;
+		}
+	}
+
+	fprintf( file, "\n]}\n" );
+
+	bool written = ( fclose( file ) eqt 0 );
+	if ( written ) printf( "trace of %d events written to %s\n", count, path );
+	else printf( "write trace to %s failed\n", path );
+
+	return written;
+};
@@ -0,0 +1,79 @@
+/**
+* <Author>        Orlando Chen
+* <Email>         seagochen@gmail.com
+* <First Time>    Oct 16, 2026
+* <Last Time>     Oct 16, 2026
+* <File Name>     Trace.h
+*/
+
+#ifndef __trace_h_
+#define __trace_h_
+
+#include "StopWatch.h"
+#include "ISO646.h"
+
+/* events each thread keeps, the oldest are overwritten past that */
+#define TRACE_EVENTS 65536
+
+/* where the trace goes, unless told otherwise */
+#define TRACE_FILE "trace.json"
+
+namespace sge
+{
+	/* a span of a thread, from begin to end, in seconds of StopWatch::Now; arg *
+	 * is the step the span belongs to, negative if none                        */
+	struct TRACEEVENT
+	{
+		const char *name;
+		double begin, end;
+		int arg;
+	};
+
+
+	/* a timeline of what every thread did, written as the trace event JSON of *
+	 * chrome://tracing and Perfetto; each thread records into a ring of its    *
+	 * own, so a thread takes no lock but for the first event it records       */
+	class Tracer
+	{
+	public:
+		/* nothing is recorded until enabled, a disabled span costs a load */
+		static void Enable( const bool on );
+
+		static bool Enabled( void );
+
+		/* the name the calling thread shows under, "thread n" if never named */
+		static void NameThread( const char *name );
+
+		/* name has to outlive the tracer, a string literal */
+		static void Record( const char *name, cdouble begin, cdouble end, cint arg );
+
+		/* write the events of every thread still in their rings to path, the *
+		 * threads may go on recording meanwhile                              */
+		static bool Dump( const char *path = TRACE_FILE );
+	};
+
+
+	/* records the span of its scope, the stages of the solver open one each */
+	class TraceScope
+	{
+	private:
+		const char *m_name;
+		double m_begin;
+		int m_arg;
+
+	public:
+		explicit TraceScope( const char *name, cint arg = -1 )
+			: m_name( Tracer::Enabled() ? name : NULL ), m_begin( m_name ? StopWatch::Now() : 0.f ), m_arg( arg ) {};
+
+		~TraceScope( void )
+		{
+			if ( m_name not_eq NULL ) Tracer::Record( m_name, m_begin, StopWatch::Now(), m_arg );
+		};
+
+	private:
+		TraceScope( const TraceScope& );
+		TraceScope &operator=( const TraceScope& );
+	};
+};
+
+#endif
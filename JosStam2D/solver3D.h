@@ -1,2 +1,13 @@
+/* pressure solvers used by project() */
+#define PRESSURE_LIN_SOLVE   0   /* 10 relaxation sweeps, the original scheme */
+#define PRESSURE_PCG_JACOBI  1   /* conjugate gradient, diagonal preconditioner */
+#define PRESSURE_PCG_MIC     2   /* conjugate gradient, modified incomplete Cholesky */
+
 void get_density(int N, float * x, float * x0, float * u, float * v, float * w, float diff, float dt );
-void get_velocity(int N, float * u, float * v,  float * w, float * u0, float * v0, float * w0, float visc, float dt );
\ No newline at end of file
+void get_velocity(int N, float * u, float * v,  float * w, float * u0, float * v0, float * w0, float visc, float dt );
+
+/* tolerance is relative to the norm of the divergence */
+void set_pressure_solver(int mode, float tolerance, int max_iterations);
+int get_pressure_solver();
+int get_pressure_iterations();
+float get_pressure_residual();
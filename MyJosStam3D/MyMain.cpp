@@ -479,6 +479,12 @@ void processKeyBoard(unsigned char key, int x, int y)
     {
         velocity_or_density=1-velocity_or_density;
     }
+
+    if(key == 'p' || key == 'P')
+    {
+        set_pressure_solver((get_pressure_solver()+1)%3, 1e-4f, 200);
+        printf("pressure solver %d, last solve took %d iterations\n", get_pressure_solver(), get_pressure_iterations());
+    }
 }
 
 void idle_func()
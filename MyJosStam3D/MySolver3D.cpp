@@ -1,3 +1,8 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "MySolver3D.h"
+
 #define IX(i,j,k) ((i)+(N+2)*(j) + (N+2)*(N+2)*(k))
 #define SWAP(x0,x) {float * tmp=x0;x0=x;x=tmp;}
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
@@ -94,6 +99,339 @@ void lin_solve(int N, int b, float *value, float *value_prev, float a, float c)
     }
 }
 
+static int pressure_solver=PRESSURE_LIN_SOLVE;
+static float pressure_tolerance=1e-4f;
+static int pressure_max_iterations=200;
+static int pressure_iterations=0;
+static float pressure_residual=-1;
+
+static int pcg_size=0;
+static float *pcg_r=NULL;
+static float *pcg_z=NULL;
+static float *pcg_s=NULL;
+static float *pcg_precon=NULL;
+
+void set_pressure_solver(int mode, float tolerance, int max_iterations)
+{
+    pressure_solver=mode;
+    pressure_tolerance=tolerance;
+    pressure_max_iterations=max_iterations;
+}
+
+int get_pressure_solver()
+{
+    return pressure_solver;
+}
+
+int get_pressure_iterations()
+{
+    return pressure_iterations;
+}
+
+float get_pressure_residual()
+{
+    return pressure_residual;
+}
+
+void pcg_allocate(int N)
+{
+    int size=(N+2)*(N+2)*(N+2);
+
+    if(size == pcg_size)
+    {
+        return;
+    }
+
+    free(pcg_r);
+    free(pcg_z);
+    free(pcg_s);
+    free(pcg_precon);
+
+    pcg_r=(float *)calloc(size, sizeof(float));
+    pcg_z=(float *)calloc(size, sizeof(float));
+    pcg_s=(float *)calloc(size, sizeof(float));
+    pcg_precon=(float *)calloc(size, sizeof(float));
+    pcg_size=size;
+}
+
+/* with boundary_condition flag 0 a wall neighbour mirrors the cell itself, so a cell *
+ * keeps one unit on the diagonal for every neighbour that lies inside the grid       */
+float pcg_diagonal(int N, int count_x, int count_y, int count_z)
+{
+    return (float)((count_x > 1)+(count_x < N)+(count_y > 1)+(count_y < N)+(count_z > 1)+(count_z < N));
+}
+
+/* MIC(0) after Bridson, tau blends in the dropped fill-in, sigma guards the pivots */
+void pcg_build_preconditioner(int N, float *precon)
+{
+    int count_x;
+    int count_y;
+    int count_z;
+
+    float tau=0.97f;
+    float sigma=0.25f;
+    float diag;
+    float e;
+    float pc;
+
+    for(count_z=1; count_z<=N; count_z++)
+    {
+        for(count_y=1; count_y<=N; count_y++)
+        {
+            for(count_x=1; count_x<=N; count_x++)
+            {
+                diag=pcg_diagonal(N, count_x, count_y, count_z);
+
+                if(pressure_solver == PRESSURE_PCG_JACOBI)
+                {
+                    precon[IX(count_x, count_y, count_z)]=1/diag;
+                    continue;
+                }
+
+                e=diag;
+
+                if(count_x > 1)
+                {
+                    pc=precon[IX(count_x-1, count_y, count_z)];
+                    e-=pc*pc*(1+tau*((count_y < N)+(count_z < N)));
+                }
+
+                if(count_y > 1)
+                {
+                    pc=precon[IX(count_x, count_y-1, count_z)];
+                    e-=pc*pc*(1+tau*((count_x < N)+(count_z < N)));
+                }
+
+                if(count_z > 1)
+                {
+                    pc=precon[IX(count_x, count_y, count_z-1)];
+                    e-=pc*pc*(1+tau*((count_x < N)+(count_y < N)));
+                }
+
+                if(e < sigma*diag)
+                {
+                    e=diag;
+                }
+
+                precon[IX(count_x, count_y, count_z)]=(float)(1.0/sqrt(e));
+            }
+        }
+    }
+}
+
+void pcg_apply_preconditioner(int N, float *z, float *r, float *precon)
+{
+    int count_x;
+    int count_y;
+    int count_z;
+
+    float t;
+
+    if(pressure_solver == PRESSURE_PCG_JACOBI)
+    {
+        for(count_z=1; count_z<=N; count_z++)
+        {
+            for(count_y=1; count_y<=N; count_y++)
+            {
+                for(count_x=1; count_x<=N; count_x++)
+                {
+                    z[IX(count_x, count_y, count_z)]=r[IX(count_x, count_y, count_z)]*precon[IX(count_x, count_y, count_z)];
+                }
+            }
+        }
+        return;
+    }
+
+    /* forward substitution with the lower factor */
+    for(count_z=1; count_z<=N; count_z++)
+    {
+        for(count_y=1; count_y<=N; count_y++)
+        {
+            for(count_x=1; count_x<=N; count_x++)
+            {
+                t=r[IX(count_x, count_y, count_z)];
+
+                if(count_x > 1) t+=precon[IX(count_x-1, count_y, count_z)]*z[IX(count_x-1, count_y, count_z)];
+                if(count_y > 1) t+=precon[IX(count_x, count_y-1, count_z)]*z[IX(count_x, count_y-1, count_z)];
+                if(count_z > 1) t+=precon[IX(count_x, count_y, count_z-1)]*z[IX(count_x, count_y, count_z-1)];
+
+                z[IX(count_x, count_y, count_z)]=t*precon[IX(count_x, count_y, count_z)];
+            }
+        }
+    }
+
+    /* back substitution with its transpose, in place */
+    for(count_z=N; count_z>=1; count_z--)
+    {
+        for(count_y=N; count_y>=1; count_y--)
+        {
+            for(count_x=N; count_x>=1; count_x--)
+            {
+                t=0;
+
+                if(count_x < N) t+=z[IX(count_x+1, count_y, count_z)];
+                if(count_y < N) t+=z[IX(count_x, count_y+1, count_z)];
+                if(count_z < N) t+=z[IX(count_x, count_y, count_z+1)];
+
+                t=z[IX(count_x, count_y, count_z)]+precon[IX(count_x, count_y, count_z)]*t;
+                z[IX(count_x, count_y, count_z)]=t*precon[IX(count_x, count_y, count_z)];
+            }
+        }
+    }
+}
+
+/* z = A s, where A is the operator lin_solve(N, 0, ..., 1, 6) relaxes */
+void pcg_apply_operator(int N, float *z, float *s)
+{
+    int count_x;
+    int count_y;
+    int count_z;
+
+    boundary_condition(N, s, 0);
+
+    for(count_z=1; count_z<=N; count_z++)
+    {
+        for(count_y=1; count_y<=N; count_y++)
+        {
+            for(count_x=1; count_x<=N; count_x++)
+            {
+                z[IX(count_x, count_y, count_z)]=6*s[IX(count_x, count_y, count_z)]-(s[IX(count_x-1, count_y, count_z)]+s[IX(count_x+1, count_y, count_z)]+s[IX(count_x, count_y-1, count_z)]+s[IX(count_x, count_y+1, count_z)]+s[IX(count_x, count_y, count_z-1)]+s[IX(count_x, count_y, count_z+1)]);
+            }
+        }
+    }
+}
+
+double pcg_dot(int N, float *a, float *b)
+{
+    int count_x;
+    int count_y;
+    int count_z;
+
+    double sum=0;
+
+    for(count_z=1; count_z<=N; count_z++)
+    {
+        for(count_y=1; count_y<=N; count_y++)
+        {
+            for(count_x=1; count_x<=N; count_x++)
+            {
+                sum+=(double)a[IX(count_x, count_y, count_z)]*b[IX(count_x, count_y, count_z)];
+            }
+        }
+    }
+
+    return sum;
+}
+
+/* y += alpha * x on the interior */
+void pcg_axpy(int N, float *y, double alpha, float *x)
+{
+    int count_x;
+    int count_y;
+    int count_z;
+
+    for(count_z=1; count_z<=N; count_z++)
+    {
+        for(count_y=1; count_y<=N; count_y++)
+        {
+            for(count_x=1; count_x<=N; count_x++)
+            {
+                y[IX(count_x, count_y, count_z)]+=(float)(alpha*x[IX(count_x, count_y, count_z)]);
+            }
+        }
+    }
+}
+
+/* matrix free preconditioned conjugate gradient on the pressure equation, stops once *
+ * |div - Ap| <= pressure_tolerance * |div| or after pressure_max_iterations steps    */
+void pcg_solve(int N, float *p, float *div)
+{
+    int count_x;
+    int count_y;
+    int count_z;
+    int count;
+
+    double mean=0;
+    double norm;
+    double rho;
+    double rho_new;
+    double alpha;
+
+    pcg_allocate(N);
+    pcg_build_preconditioner(N, pcg_precon);
+
+    /* the walls make A singular, only the part of div with zero mean can be matched */
+    for(count_z=1; count_z<=N; count_z++)
+    {
+        for(count_y=1; count_y<=N; count_y++)
+        {
+            for(count_x=1; count_x<=N; count_x++)
+            {
+                mean+=div[IX(count_x, count_y, count_z)];
+            }
+        }
+    }
+    mean=mean/((double)N*N*N);
+
+    for(count_z=1; count_z<=N; count_z++)
+    {
+        for(count_y=1; count_y<=N; count_y++)
+        {
+            for(count_x=1; count_x<=N; count_x++)
+            {
+                p[IX(count_x, count_y, count_z)]=0;
+                pcg_r[IX(count_x, count_y, count_z)]=(float)(div[IX(count_x, count_y, count_z)]-mean);
+            }
+        }
+    }
+
+    norm=sqrt(pcg_dot(N, pcg_r, pcg_r));
+    pressure_iterations=0;
+    pressure_residual=0;
+
+    if(norm > 0)
+    {
+        pcg_apply_preconditioner(N, pcg_z, pcg_r, pcg_precon);
+        memcpy(pcg_s, pcg_z, pcg_size*sizeof(float));
+        rho=pcg_dot(N, pcg_z, pcg_r);
+
+        for(count=0; count<pressure_max_iterations; count++)
+        {
+            pcg_apply_operator(N, pcg_z, pcg_s);
+            alpha=rho/pcg_dot(N, pcg_z, pcg_s);
+
+            pcg_axpy(N, p, alpha, pcg_s);
+            pcg_axpy(N, pcg_r, -alpha, pcg_z);
+
+            pressure_iterations=count+1;
+            pressure_residual=(float)(sqrt(pcg_dot(N, pcg_r, pcg_r))/norm);
+
+            if(pressure_residual <= pressure_tolerance)
+            {
+                break;
+            }
+
+            pcg_apply_preconditioner(N, pcg_z, pcg_r, pcg_precon);
+            rho_new=pcg_dot(N, pcg_z, pcg_r);
+
+            /* s = z + ( rho_new / rho ) s */
+            for(count_z=1; count_z<=N; count_z++)
+            {
+                for(count_y=1; count_y<=N; count_y++)
+                {
+                    for(count_x=1; count_x<=N; count_x++)
+                    {
+                        pcg_s[IX(count_x, count_y, count_z)]=(float)(pcg_z[IX(count_x, count_y, count_z)]+rho_new/rho*pcg_s[IX(count_x, count_y, count_z)]);
+                    }
+                }
+            }
+            rho=rho_new;
+        }
+    }
+
+    boundary_condition(N, p, 0);
+}
+
 void diffuse(int N, int b, float *value, float *value_prev, float diff, float dt)
 {
     float alpha=dt*diff*N*N*N;
@@ -214,7 +552,16 @@ void project(int N, float *velocity_u, float *velocity_v, float *velocity_w, flo
     boundary_condition(N, div, 0);
     boundary_condition(N, p, 0);
 
-    lin_solve(N, 0, p, div, 1, 6);
+    if(pressure_solver == PRESSURE_LIN_SOLVE)
+    {
+        lin_solve(N, 0, p, div, 1, 6);
+        pressure_iterations=10;
+        pressure_residual=-1;
+    }
+    else
+    {
+        pcg_solve(N, p, div);
+    }
 
     for(count_x=1; count_x<=N; count_x++)
     {